@@ -66,15 +66,11 @@ string summary( const EthernetFrame& frame )
 
 optional<EthernetFrame> maybe_receive_frame( FileDescriptor& fd )
 {
-  vector<string> strs( 3 );
-  strs.at( 0 ).resize( EthernetHeader::LENGTH );
-  strs.at( 1 ).resize( IPv4Header::LENGTH );
-  fd.read( strs );
+  Buffer packet;
+  fd.read( packet );
 
   EthernetFrame frame;
-  vector<Buffer> buffers;
-  ranges::transform( strs, back_inserter( buffers ), identity() );
-  if ( not parse( frame, buffers ) ) {
+  if ( not parse( frame, { move( packet ) } ) ) {
     return {};
   }
 
@@ -121,16 +117,42 @@ public:
 
     return {};
   }
+  void read_batch( vector<TCPSegment>& segments, const size_t max_datagrams )
+  {
+    vector<Buffer> packets( max_datagrams );
+    const size_t count = _data_socket_pair.first.read( span { packets } );
+    for ( size_t i = 0; i < count; ++i ) {
+      EthernetFrame frame;
+      if ( not parse( frame, { move( packets[i] ) } ) ) {
+        continue;
+      }
+      if ( auto ip_dgram = _interface.recv_frame( frame ) ) {
+        if ( auto seg = unwrap_tcp_in_ip( ip_dgram.value() ) ) {
+          segments.push_back( move( seg.value() ) );
+        }
+      }
+    }
+    send_pending();
+  }
   void write( TCPSegment& seg )
   {
     _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
     send_pending();
   }
+  size_t write_batch( span<TCPSegment> segments )
+  {
+    for ( auto& seg : segments ) {
+      _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
+    }
+    send_pending();
+    return segments.size();
+  }
   void tick( const size_t ms_since_last_tick )
   {
     _interface.tick( ms_since_last_tick );
     send_pending();
   }
+  std::optional<uint64_t> ms_until_deadline() const { return _interface.ms_until_deadline(); }
   NetworkInterface& interface() { return _interface; }
 
   FileDescriptor& fd() { return _data_socket_pair.first; }
@@ -31,6 +31,7 @@ ttest(reassembler_dup)
 ttest(reassembler_holes)
 ttest(reassembler_overlapping)
 ttest(reassembler_win)
+ttest(reassembler_bitmap)
 
 ttest(wrapping_integers_cmp)
 ttest(wrapping_integers_wrap)
@@ -56,7 +57,17 @@ ttest(send_extra)
 
 ttest(net_interface)
 
+ttest(checksum)
+ttest(ipv4_checksum)
+ttest(header_view)
+ttest(buffer_slices)
+ttest(datagram_batch)
+ttest(eventloop)
+ttest(tcp_stack)
+
 ttest(router)
+ttest(router_updates)
+ttest(router_sharded)
 
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R 'webget|^byte_stream_')
 
@@ -90,3 +101,13 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(checksum_speed_test)
+stest(router_speed_test)
+stest(net_interface_speed_test)
+stest(header_template_speed_test)
+stest(serialize_speed_test)
+stest(buffer_pool_speed_test)
+stest(datagram_batch_speed_test)
+stest(eventloop_speed_test)
+stest(io_uring_speed_test)
+stest(tcp_stack_speed_test)
@@ -1,10 +1,14 @@
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 #include "byte_stream.hh"
 
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ) {}
+ByteStream::ByteStream( uint64_t capacity, Storage storage )
+  : capacity_( capacity ), storage_( storage ), buffer_( storage == Storage::Ring ? capacity : 0, '\0' )
+{}
 
 void Writer::push( string data )
 {
@@ -13,16 +17,50 @@ void Writer::push( string data )
     return;
   }
 
-  const uint64_t data_length = data.length();
-  const uint64_t available_length = available_capacity();
-  const uint64_t length = data_length >= available_length ? available_length : data_length;
+  const uint64_t length = min( static_cast<uint64_t>( data.length() ), available_capacity() );
+  if ( length == 0 ) {
+    return;
+  }
+
+  if ( storage_ == Storage::Chunked ) {
+    data.resize( length );
+    chunks_.emplace_back( std::move( data ) );
+    bytes_pushed_ += length;
+    return;
+  }
+
+  copy_to_ring( string_view { data }.substr( 0, length ) );
+}
+
+void Writer::push( Buffer data )
+{
+  if ( is_closed() || data.empty() ) {
+    return;
+  }
 
-  if ( data_length >= available_length ) {
-    buffer_.append( data.substr( 0, length ) );
-  } else {
-    buffer_.append( std::move( data ) );
+  const uint64_t length = min( static_cast<uint64_t>( data.length() ), available_capacity() );
+  if ( length == 0 ) {
+    return;
   }
-  bytes_pushed_ += length;
+
+  if ( storage_ == Storage::Chunked ) {
+    // A small slice is copied rather than keeping (e.g.) a whole pooled packet buffer alive.
+    chunks_.push_back( ( length < data.length() ? data.substr( 0, length ) : std::move( data ) ).compact() );
+    bytes_pushed_ += length;
+    return;
+  }
+
+  copy_to_ring( string_view { data }.substr( 0, length ) );
+}
+
+void Writer::copy_to_ring( const string_view data )
+{
+  // Copy into the tail of the ring, wrapping around to the front if needed.
+  const uint64_t tail = bytes_pushed_ % capacity_;
+  const uint64_t first_run = min( static_cast<uint64_t>( data.length() ), capacity_ - tail );
+  memcpy( buffer_.data() + tail, data.data(), first_run );
+  memcpy( buffer_.data(), data.data() + first_run, data.length() - first_run );
+  bytes_pushed_ += data.length();
 }
 
 void Writer::close()
@@ -58,13 +96,53 @@ uint64_t Writer::bytes_pushed() const
 string_view Reader::peek() const
 {
   // Your code here.
-  return { buffer_ };
+  const uint64_t buffered = bytes_buffered();
+  if ( buffered == 0 ) {
+    return {};
+  }
+
+  if ( storage_ == Storage::Chunked ) {
+    return string_view { chunks_.front() }.substr( chunk_offset_ );
+  }
+
+  // Only the run up to the end of the ring is contiguous; the rest is visible after a pop.
+  const uint64_t head = bytes_popped_ % capacity_;
+  return { buffer_.data() + head, min( buffered, capacity_ - head ) };
+}
+
+vector<string_view> Reader::peek_views( uint64_t max_bytes ) const
+{
+  vector<string_view> views;
+  max_bytes = min( max_bytes, bytes_buffered() );
+  if ( max_bytes == 0 ) {
+    return views;
+  }
+
+  if ( storage_ == Storage::Chunked ) {
+    uint64_t offset = chunk_offset_;
+    for ( auto it = chunks_.begin(); it != chunks_.end() and max_bytes > 0; ++it ) {
+      const auto view = string_view { *it }.substr( offset, max_bytes );
+      views.push_back( view );
+      max_bytes -= view.size();
+      offset = 0;
+    }
+    return views;
+  }
+
+  // The ring holds at most two regions: up to the end of the buffer, then from its start.
+  const uint64_t head = bytes_popped_ % capacity_;
+  const uint64_t first_run = min( max_bytes, capacity_ - head );
+  views.emplace_back( buffer_.data() + head, first_run );
+  if ( max_bytes > first_run ) {
+    views.emplace_back( buffer_.data(), max_bytes - first_run );
+  }
+  return views;
 }
 
 bool Reader::is_finished() const
 {
   // Your code here.
-  return closed_ && buffer_.empty();
+  return closed_ && bytes_buffered() == 0;
 }
 
 bool Reader::has_error() const
@@ -76,21 +154,23 @@ bool Reader::has_error() const
 void Reader::pop( uint64_t len )
 {
   // Your code here.
-  if ( buffer_.empty() ) {
-    return;
+  len = min( len, bytes_buffered() );
+  bytes_popped_ += len;
+
+  if ( storage_ == Storage::Chunked ) {
+    // Drop every chunk that is now fully consumed, then advance into the next one.
+    chunk_offset_ += len;
+    while ( not chunks_.empty() and chunk_offset_ >= chunks_.front().size() ) {
+      chunk_offset_ -= chunks_.front().size();
+      chunks_.pop_front();
+    }
   }
-
-  uint64_t buffer_length = buffer_.length();
-  uint64_t length = len >= buffer_length ? buffer_length : len;
-
-  buffer_.erase( 0, length );
-  bytes_popped_ += length;
 }
 
 uint64_t Reader::bytes_buffered() const
 {
   // Your code here.
-  return buffer_.length();
+  return bytes_pushed_ - bytes_popped_;
 }
 
 uint64_t Reader::bytes_popped() const
@@ -1,26 +1,45 @@
 #pragma once
 
+#include "buffer.hh"
+
+#include <deque>
+#include <limits>
 #include <queue>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
 
 class Reader;
 class Writer;
 
 class ByteStream
 {
+public:
+  // How buffered bytes are stored.
+  enum class Storage
+  {
+    Ring,    // One circular buffer of `capacity` bytes, allocated up front. Each pushed byte is copied in.
+    Chunked, // Each pushed string is kept intact as a refcounted chunk. Nothing is copied on push or pop.
+  };
+
 protected:
   uint64_t capacity_;
+  Storage storage_;
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
+  // Ring: circular buffer of `capacity_` bytes, allocated once. The read position is bytes_popped_ % capacity_
+  // and the write position is bytes_pushed_ % capacity_.
   std::string buffer_ {};
+  // Chunked: the pushed strings, and how many bytes of the front one have already been popped.
+  std::deque<Buffer> chunks_ {};
+  uint64_t chunk_offset_ { 0 };
   uint64_t bytes_pushed_ { 0 };
   uint64_t bytes_popped_ { 0 };
   bool error_ { false };
   bool closed_ { false };
 
 public:
-  explicit ByteStream( uint64_t capacity );
+  explicit ByteStream( uint64_t capacity, Storage storage = Storage::Ring );
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -31,8 +50,12 @@ public:
 
 class Writer : public ByteStream
 {
+  // Copy `data` into the tail of the ring
+  void copy_to_ring( std::string_view data );
+
 public:
   void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
+  void push( Buffer data );      // Same, but a Chunked stream keeps a reference to `data` (see Buffer::compact()).
 
   void close();     // Signal that the stream has reached its ending. Nothing more will be written.
   void set_error(); // Signal that the stream suffered an error.
@@ -45,9 +68,12 @@ public:
 class Reader : public ByteStream
 {
 public:
-  std::string_view peek() const; // Peek at the next bytes in the buffer
+  std::string_view peek() const; // Peek at the next contiguous bytes in the buffer
   void pop( uint64_t len );      // Remove `len` bytes from the buffer
 
+  // Peek at up to `max_bytes` buffered bytes as a list of contiguous regions (e.g. for writev)
+  std::vector<std::string_view> peek_views( uint64_t max_bytes = std::numeric_limits<uint64_t>::max() ) const;
+
   bool is_finished() const; // Is the stream finished (closed and fully popped)?
   bool has_error() const;   // Has the stream had an error?
 
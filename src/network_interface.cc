@@ -12,7 +12,7 @@ NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, con
   , ip_address_( ip_address )
   , mappings_()
   , ready_frames_()
-  , unready_frames_()
+  , pending_datagrams_()
 {
   cerr << "DEBUG: Network interface has Ethernet address " << to_string( ethernet_address_ ) << " and IP address "
        << ip_address.ip() << "\n";
@@ -33,39 +33,54 @@ void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Addre
    *     corresponding to this IP address, and store this <InternetDatagram, next_hop>.
    *     Once the MAC address for the IP is received, send the network datagram.
    */
-  EthernetFrame frame;
 
   // Check if the MAC address for next_hop is known.
-  if ( mappings_.contains( next_hop.ipv4_numeric() ) ) {
-    auto [eAddress, time] = mappings_[next_hop.ipv4_numeric()];
-    frame.header.type = EthernetHeader::TYPE_IPv4;
-    frame.header.dst = eAddress;
-    frame.header.src = ethernet_address_;
-    frame.payload = serialize( dgram );
-    ready_frames_.push_back( frame );
+  const uint32_t next_hop_ip = next_hop.ipv4_numeric();
+  const auto mapping = mappings_.find( next_hop_ip );
+  if ( mapping != mappings_.end() ) {
+    send_frame( dgram, mapping->second.first );
+    return;
+  }
+
+  // Store the datagram for later sending, unless too many are already waiting on this next hop.
+  auto& pending = pending_datagrams_[next_hop_ip];
+  if ( pending.size() < MAX_PENDING_PER_NEIGHBOR ) {
+    pending.push_back( dgram );
   } else {
-    // Store the datagram and next_hop for later sending.
-    unready_frames_.emplace_back( dgram, next_hop );
-    // Send ARP request.
-    if ( !arp_times_.contains( next_hop.ipv4_numeric() ) ) {
-      arp_times_[next_hop.ipv4_numeric()] = timestamp_;
-      // Create ARP Message.
-      ARPMessage arpMessage;
-      arpMessage.opcode = ARPMessage::OPCODE_REQUEST;
-      arpMessage.sender_ip_address = ip_address_.ipv4_numeric();
-      arpMessage.sender_ethernet_address = ethernet_address_;
-      arpMessage.target_ip_address = next_hop.ipv4_numeric();
-      arpMessage.target_ethernet_address = {};
-      // Create Ethernet Message.
-      frame.header.src = ethernet_address_;
-      frame.header.dst = ETHERNET_BROADCAST;
-      frame.header.type = EthernetHeader::TYPE_ARP;
-      frame.payload = serialize( arpMessage );
-      ready_frames_.push_back( frame );
-    }
+    ++dropped_datagrams_;
+  }
+
+  // Send ARP request.
+  if ( !arp_times_.contains( next_hop_ip ) ) {
+    arp_times_[next_hop_ip] = timestamp_;
+    arp_request_timers_.schedule( next_hop_ip, timestamp_ + ARP_REQUEST_TIMEOUT_MS );
+    // Create ARP Message.
+    ARPMessage arpMessage;
+    arpMessage.opcode = ARPMessage::OPCODE_REQUEST;
+    arpMessage.sender_ip_address = ip_address_.ipv4_numeric();
+    arpMessage.sender_ethernet_address = ethernet_address_;
+    arpMessage.target_ip_address = next_hop_ip;
+    arpMessage.target_ethernet_address = {};
+    // Create Ethernet Message.
+    EthernetFrame frame;
+    frame.header.src = ethernet_address_;
+    frame.header.dst = ETHERNET_BROADCAST;
+    frame.header.type = EthernetHeader::TYPE_ARP;
+    frame.payload = serialize( arpMessage );
+    ready_frames_.push_back( move( frame ) );
   }
 }
 
+void NetworkInterface::send_frame( const InternetDatagram& dgram, const EthernetAddress& dst )
+{
+  EthernetFrame frame;
+  frame.header.type = EthernetHeader::TYPE_IPv4;
+  frame.header.dst = dst;
+  frame.header.src = ethernet_address_;
+  frame.payload = serialize( dgram );
+  ready_frames_.push_back( move( frame ) );
+}
+
 // frame: the incoming Ethernet frame
 optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& frame )
 {
@@ -87,19 +102,18 @@ optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& fr
 
     // Update ARP table with sender information.
     mappings_[arpMessage.sender_ip_address] = { arpMessage.sender_ethernet_address, timestamp_ };
+    mapping_timers_.schedule( arpMessage.sender_ip_address, timestamp_ + MAPPING_TIMEOUT_MS );
 
     // Erase ARP request timestamp if existing.
     arp_times_.erase( arpMessage.sender_ip_address );
 
-    // Process unready frames now that we have new ARP information.
-    auto it = unready_frames_.begin();
-    while ( it != unready_frames_.end() ) {
-      auto [dgram, addr] = *it;
-      if ( mappings_.contains( addr.ipv4_numeric() ) ) {
-        send_datagram( dgram, addr );
-        it = unready_frames_.erase( it );
-      } else {
-        ++it;
+    // Send the datagrams that were waiting for this address.
+    const auto pending = pending_datagrams_.find( arpMessage.sender_ip_address );
+    if ( pending != pending_datagrams_.end() ) {
+      const vector<InternetDatagram> datagrams = move( pending->second );
+      pending_datagrams_.erase( pending );
+      for ( const auto& dgram : datagrams ) {
+        send_frame( dgram, arpMessage.sender_ethernet_address );
       }
     }
 
@@ -130,23 +144,38 @@ void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
   timestamp_ += ms_since_last_tick;
 
-  // Remove expired ARP times.
-  for ( auto it = arp_times_.begin(); it != arp_times_.end(); ) {
-    if ( timestamp_ - it->second >= 5000 ) {
-      it = arp_times_.erase( it );
-    } else {
-      ++it;
+  // Remove expired ARP times, and drop the datagrams that were waiting on the unanswered requests.
+  arp_request_timers_.expire( timestamp_, [this]( uint32_t ip, uint64_t deadline ) {
+    const auto it = arp_times_.find( ip );
+    if ( it != arp_times_.end() and it->second + ARP_REQUEST_TIMEOUT_MS == deadline ) {
+      arp_times_.erase( it );
+      const auto pending = pending_datagrams_.find( ip );
+      if ( pending != pending_datagrams_.end() ) {
+        dropped_datagrams_ += pending->second.size();
+        pending_datagrams_.erase( pending );
+      }
     }
-  }
+  } );
 
   // Delete expired mappings.
-  for ( auto it = mappings_.begin(); it != mappings_.end(); ) {
-    if ( timestamp_ - it->second.second >= 30000 ) {
-      it = mappings_.erase( it );
-    } else {
-      ++it;
+  mapping_timers_.expire( timestamp_, [this]( uint32_t ip, uint64_t deadline ) {
+    const auto it = mappings_.find( ip );
+    if ( it != mappings_.end() and it->second.second + MAPPING_TIMEOUT_MS == deadline ) {
+      mappings_.erase( it );
     }
+  } );
+}
+
+optional<uint64_t> NetworkInterface::ms_until_deadline() const
+{
+  const auto arp_deadline = arp_request_timers_.next_deadline();
+  const auto mapping_deadline = mapping_timers_.next_deadline();
+  if ( not arp_deadline and not mapping_deadline ) {
+    return {};
   }
+  const uint64_t deadline
+    = min( arp_deadline.value_or( UINT64_MAX ), mapping_deadline.value_or( UINT64_MAX ) );
+  return deadline > timestamp_ ? deadline - timestamp_ : 0;
 }
 
 optional<EthernetFrame> NetworkInterface::maybe_send()
@@ -3,6 +3,7 @@
 #include "address.hh"
 #include "ethernet_frame.hh"
 #include "ipv4_datagram.hh"
+#include "timer_queue.hh"
 
 #include <iostream>
 #include <list>
@@ -46,12 +47,29 @@ private:
 
   // Frames ready to be sent, as their destination MAC addresses are known.
   std::deque<EthernetFrame> ready_frames_;
-  // Frames not ready to be sent.
-  std::deque<std::pair<InternetDatagram, Address>> unready_frames_;
+  // Datagrams waiting for their next hop's Ethernet address, by next-hop IP address (oldest first).
+  std::unordered_map<uint32_t, std::vector<InternetDatagram>> pending_datagrams_;
+  // The most datagrams held for one unresolved next hop; later ones are dropped.
+  static constexpr size_t MAX_PENDING_PER_NEIGHBOR = 64;
+  // Datagrams dropped because their next hop did not answer ARP in time, or had too many waiting.
+  uint64_t dropped_datagrams_ {};
+
+  // How long a learned mapping lasts, and how long to wait before repeating an ARP request.
+  static constexpr uint64_t MAPPING_TIMEOUT_MS = 30000;
+  static constexpr uint64_t ARP_REQUEST_TIMEOUT_MS = 5000;
 
   size_t timestamp_ { 0 };
   std::unordered_map<uint32_t, uint64_t> arp_times_ {};
 
+  // Expiry timers for mappings_ (30 s after learning) and arp_times_ (5 s after requesting), by IP address.
+  // When an ARP request expires unanswered, the datagrams waiting on it are dropped.
+  // A timer whose deadline no longer matches its entry is stale and ignored.
+  TimerQueue<uint32_t> mapping_timers_ {};
+  TimerQueue<uint32_t> arp_request_timers_ {};
+
+  // Encapsulate `dgram` in a frame to `dst` and queue it for sending.
+  void send_frame( const InternetDatagram& dgram, const EthernetAddress& dst );
+
 public:
   // Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer)
   // addresses
@@ -75,4 +93,10 @@ public:
 
   // Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
+
+  // How many more milliseconds of ticks until a mapping or ARP request expires (empty if none is pending)
+  std::optional<uint64_t> ms_until_deadline() const;
+
+  // How many datagrams have been dropped for want of their next hop's Ethernet address
+  uint64_t dropped_datagrams() const { return dropped_datagrams_; }
 };
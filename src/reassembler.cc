@@ -1,91 +1,195 @@
 #include "reassembler.hh"
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iterator>
+
 using namespace std;
 
+namespace {
+
+string into_string( string&& data )
+{
+  return std::move( data );
+}
+
+string into_string( Buffer&& data )
+{
+  return std::move( data ).take();
+}
+
+} // namespace
+
 void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring, Writer& output )
+{
+  insert_bytes( first_index, std::move( data ), is_last_substring, output );
+}
+
+void Reassembler::insert( uint64_t first_index, Buffer data, bool is_last_substring, Writer& output )
+{
+  insert_bytes( first_index, std::move( data ), is_last_substring, output );
+}
+
+template<class Data>
+void Reassembler::insert_bytes( uint64_t first_index, Data data, bool is_last_substring, Writer& output )
 {
   // Your code here.
-  const uint64_t available_capacity = output.available_capacity();
-  const uint64_t first_unacceptable = first_unassembled_ + available_capacity;
-  const uint64_t data_length = data.length();
+  const uint64_t first_unacceptable = first_unassembled_ + output.available_capacity();
+  const uint64_t last_index = first_index + data.length();
 
-  // Return if the data is already assembled or beyond the acceptable range.
-  if ( ( first_index + data_length <= first_unassembled_ && data_length != 0 )
-       || first_index > first_unacceptable ) {
-    return;
+  // The end of the stream is only known if the last substring fits within the acceptable range.
+  if ( is_last_substring && last_index <= first_unacceptable ) {
+    finish_received_ = true;
+    end_index_ = last_index;
   }
 
-  // If data exceeds the acceptable range, crop it and update is_last_substring flag.
-  if ( first_index + data_length > first_unacceptable ) {
-    data = data.substr( 0, first_unacceptable - first_index );
-    is_last_substring = false;
-  }
+  // Clip the data to [first_unassembled_, first_unacceptable).
+  const uint64_t start = max( first_index, first_unassembled_ );
+  const uint64_t end = min( last_index, first_unacceptable );
+  if ( start < end && storage_ == Storage::Bitmap ) {
+    store_in_window( start, string_view { data }.substr( start - first_index, end - start ), output );
+  } else if ( start < end ) {
+    if ( start != first_index || end != last_index ) {
+      data = data.substr( start - first_index, end - start );
+    }
 
-  // Insert or update data in the map.
-  auto it = unassembled_.find( first_index );
-  if ( it == unassembled_.end() ) {
-    unassembled_[first_index] = data;
-  } else {
-    if ( data_length > it->second.length() ) {
-      unassembled_[first_index] = data;
+    if ( start == first_unassembled_ && ( unassembled_.empty() || unassembled_.begin()->first >= end ) ) {
+      // Nothing stored overlaps these bytes, so they can be written without being stored first.
+      first_unassembled_ = end;
+      output.push( std::move( data ) );
+    } else {
+      store( start, into_string( std::move( data ) ) );
+    }
+
+    // Only the first stored range can be contiguous with what has already been written.
+    auto first = unassembled_.begin();
+    if ( first != unassembled_.end() && first->first == first_unassembled_ ) {
+      bytes_pending_ -= first->second.length();
+      first_unassembled_ += first->second.length();
+      output.push( std::move( first->second ) );
+      unassembled_.erase( first );
     }
   }
 
-  // Iterate over the map and push assembled data to output.
-  for ( it = unassembled_.begin(); it != unassembled_.end(); ) {
-    // Break if a hole is found in the data.
-    if ( it->first > first_unassembled_ ) {
-      break;
+  // Close the output once every byte up to the end of the stream has been written.
+  if ( finish_received_ && first_unassembled_ == end_index_ ) {
+    output.close();
+  }
+}
+
+void Reassembler::store( uint64_t start, string data )
+{
+  const uint64_t end = start + data.length();
+
+  // Find the range that will hold the new bytes: either a predecessor that overlaps or touches them, or a new one.
+  auto next = unassembled_.upper_bound( start );
+  auto node = unassembled_.end();
+  if ( next != unassembled_.begin() ) {
+    auto prev = std::prev( next );
+    const uint64_t prev_end = prev->first + prev->second.length();
+    if ( prev_end >= end ) {
+      return; // Already have every byte.
     }
+    if ( prev_end >= start ) {
+      prev->second.append( data, prev_end - start );
+      bytes_pending_ += end - prev_end;
+      node = prev;
+    }
+  }
+  if ( node == unassembled_.end() ) {
+    bytes_pending_ += data.length();
+    node = unassembled_.emplace_hint( next, start, std::move( data ) );
+  }
 
-    // Remove fully assembled data.
-    if ( it->first + it->second.length() <= first_unassembled_ ) {
-      auto tmp = it;
-      it++;
-      unassembled_.erase( tmp );
-    } else {
-      // Push string to output and update the index.
-      output.push( it->second.substr( first_unassembled_ - it->first ) );
-      first_unassembled_ = it->first + it->second.length();
-      auto tmp = it;
-      it++;
-      unassembled_.erase( tmp );
+  // Absorb any successors that the grown range now overlaps or touches.
+  uint64_t node_end = node->first + node->second.length();
+  while ( next != unassembled_.end() && next->first <= node_end ) {
+    const uint64_t next_end = next->first + next->second.length();
+    if ( next_end > node_end ) {
+      node->second.append( next->second, node_end - next->first );
+      bytes_pending_ += next_end - node_end;
+      node_end = next_end;
     }
+    bytes_pending_ -= next->second.length();
+    next = unassembled_.erase( next );
   }
+}
 
-  // Set finish flag if the last substring is received.
-  if ( is_last_substring ) {
-    finish_received_ = true;
+void Reassembler::store_in_window( uint64_t start, string_view data, Writer& output )
+{
+  // Size the window to the output's full capacity the first time it is needed.
+  if ( window_.empty() ) {
+    const uint64_t capacity = output.available_capacity() + output.reader().bytes_buffered();
+    window_.resize( capacity );
+    received_.assign( ( capacity + 63 ) / 64, 0 );
   }
+  const uint64_t capacity = window_.size();
 
-  // Close the output if finished and no data is pending.
-  if ( finish_received_ && bytes_pending() == 0 ) {
-    output.close();
+  // Copy the bytes straight into their slots, splitting where the ring wraps.
+  const uint64_t slot = start % capacity;
+  const uint64_t first_run = min( static_cast<uint64_t>( data.size() ), capacity - slot );
+  memcpy( window_.data() + slot, data.data(), first_run );
+  memcpy( window_.data(), data.data() + first_run, data.size() - first_run );
+  bytes_pending_ += mark_slots( slot, slot + first_run, true );
+  bytes_pending_ += mark_slots( 0, data.size() - first_run, true );
+
+  // Find the run of received bytes at first_unassembled_ and write it with one push.
+  const uint64_t head = first_unassembled_ % capacity;
+  uint64_t run = received_run( head, capacity );
+  if ( run == capacity - head ) {
+    run += received_run( 0, head );
   }
+  if ( run == 0 ) {
+    return;
+  }
+
+  const uint64_t head_run = min( run, capacity - head );
+  string contiguous;
+  contiguous.reserve( run );
+  contiguous.append( window_, head, head_run );
+  contiguous.append( window_, 0, run - head_run );
+  mark_slots( head, head + head_run, false );
+  mark_slots( 0, run - head_run, false );
+
+  bytes_pending_ -= run;
+  first_unassembled_ += run;
+  output.push( std::move( contiguous ) );
 }
 
-uint64_t Reassembler::bytes_pending() const
+uint64_t Reassembler::mark_slots( uint64_t begin, uint64_t end, bool received )
 {
-  // Your code here.
-  uint64_t bytes_count = 0;
-  uint64_t largest_index = first_unassembled_;
-
-  // Iterate over the map to count the bytes.
-  for ( const auto& pair : unassembled_ ) {
-    uint64_t start = pair.first;
-    uint64_t end = start + pair.second.length();
-
-    // Add bytes that are not yet assembled.
-    if ( start <= largest_index ) {
-      if ( end > largest_index ) {
-        bytes_count += end - largest_index;
-        largest_index = end;
-      }
-    } else {
-      bytes_count += pair.second.length();
-      largest_index = end;
+  uint64_t changed = 0;
+  while ( begin < end ) {
+    const uint64_t bit = begin % 64;
+    const uint64_t count = min( 64 - bit, end - begin );
+    const uint64_t mask = ( count == 64 ? ~uint64_t { 0 } : ( uint64_t { 1 } << count ) - 1 ) << bit;
+    uint64_t& word = received_[begin / 64];
+    const uint64_t before = word;
+    word = received ? ( word | mask ) : ( word & ~mask );
+    changed += popcount( before ^ word );
+    begin += count;
+  }
+  return changed;
+}
+
+uint64_t Reassembler::received_run( uint64_t begin, uint64_t end ) const
+{
+  // Scan a word at a time; bits past the end of the window are never set, so the scan stops there.
+  uint64_t run = 0;
+  while ( begin + run < end ) {
+    const uint64_t bit = ( begin + run ) % 64;
+    const auto ones = static_cast<uint64_t>( countr_one( received_[( begin + run ) / 64] >> bit ) );
+    run += ones;
+    if ( ones < 64 - bit ) {
+      break;
     }
   }
+  return min( run, end - begin );
+}
 
-  return bytes_count;
+uint64_t Reassembler::bytes_pending() const
+{
+  // Your code here.
+  return bytes_pending_;
 }
@@ -4,15 +4,53 @@
 
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 
 class Reassembler
 {
+public:
+  // How bytes that arrive ahead of the stream are stored.
+  enum class Storage
+  {
+    Map,    // Disjoint ranges in a std::map, allocated as segments arrive.
+    Bitmap, // A ring the size of the output's capacity plus one bit per byte, allocated once on first use.
+  };
+
 private:
+  Storage storage_;
+
+  // Map: disjoint, non-adjacent byte ranges that arrived ahead of first_unassembled_, keyed by first index.
   std::map<uint64_t, std::string> unassembled_ {};
+  // Bitmap: stream index i lives at window_[i % window_.size()], and bit i % window_.size() of received_
+  // says whether it has arrived.
+  std::string window_ {};
+  std::vector<uint64_t> received_ {};
+
   uint64_t first_unassembled_ { 0 };
+  // Total number of bytes stored but not yet written.
+  uint64_t bytes_pending_ { 0 };
   bool finish_received_ { false };
+  // Index one past the last byte of the stream (valid once finish_received_ is set).
+  uint64_t end_index_ { 0 };
+
+  // insert() for a std::string or a Buffer
+  template<class Data>
+  void insert_bytes( uint64_t first_index, Data data, bool is_last_substring, Writer& output );
+
+  // Merge `data`, starting at stream index `start`, into the stored ranges.
+  void store( uint64_t start, std::string data );
+
+  // Copy `data`, starting at stream index `start`, into the window and push any bytes that became contiguous.
+  void store_in_window( uint64_t start, std::string_view data, Writer& output );
+  // Set or clear the received bits for window slots [begin, end); returns how many bits changed.
+  uint64_t mark_slots( uint64_t begin, uint64_t end, bool received );
+  // Count the received slots in a row starting at `begin`, stopping at `end`.
+  uint64_t received_run( uint64_t begin, uint64_t end ) const;
 
 public:
+  explicit Reassembler( Storage storage = Storage::Map ) : storage_( storage ) {}
+
   /*
    * Insert a new substring to be reassembled into a ByteStream.
    *   `first_index`: the index of the first byte of the substring
@@ -35,6 +73,9 @@ public:
    */
   void insert( uint64_t first_index, std::string data, bool is_last_substring, Writer& output );
 
+  // Same, but bytes that can be written right away are pushed as a slice of `data`, sharing its storage.
+  void insert( uint64_t first_index, Buffer data, bool is_last_substring, Writer& output );
+
   // How many bytes are stored in the Reassembler itself?
   uint64_t bytes_pending() const;
 };
@@ -0,0 +1,70 @@
+#include "route_table.hh"
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+using namespace std;
+
+RouteTable::RouteTable( const vector<RouterEntry>& routes ) : first_level_( size_t { 1 } << 16 )
+{
+  // Expand shorter prefixes first, so that longer ones overwrite them; within a length, the
+  // earliest route is written last.
+  vector<size_t> order( routes.size() );
+  iota( order.begin(), order.end(), 0 );
+  stable_sort( order.begin(), order.end(), [&]( size_t a, size_t b ) {
+    if ( routes[a].prefix_length != routes[b].prefix_length ) {
+      return routes[a].prefix_length < routes[b].prefix_length;
+    }
+    return a > b;
+  } );
+
+  for ( const size_t index : order ) {
+    const uint32_t prefix = routes[index].route_prefix;
+    const uint8_t length = min( routes[index].prefix_length, uint8_t { 32 } );
+    const uint32_t mask = length == 0 ? 0 : ~uint32_t { 0 } << ( 32 - length );
+
+    // A prefix with bits set past its length can never match a destination.
+    if ( prefix & ~mask ) {
+      continue;
+    }
+
+    const auto value = static_cast<uint32_t>( index + 1 );
+    if ( length <= 16 ) {
+      const auto first = first_level_.begin() + ( prefix >> 16 );
+      fill( first, first + ( size_t { 1 } << ( 16 - length ) ), value );
+    } else if ( length <= 24 ) {
+      const uint32_t chunk = child( first_level_[prefix >> 16] );
+      const auto first = chunks_.begin() + chunk * CHUNK_SIZE + ( ( prefix >> 8 ) & 0xff );
+      fill( first, first + ( size_t { 1 } << ( 24 - length ) ), value );
+    } else {
+      const uint32_t middle = child( first_level_[prefix >> 16] );
+      const uint32_t chunk = child( chunks_[middle * CHUNK_SIZE + ( ( prefix >> 8 ) & 0xff )] );
+      const auto first = chunks_.begin() + chunk * CHUNK_SIZE + ( prefix & 0xff );
+      fill( first, first + ( size_t { 1 } << ( 32 - length ) ), value );
+    }
+  }
+}
+
+uint32_t RouteTable::child( uint32_t& slot )
+{
+  if ( slot & CHILD ) {
+    return slot & ~CHILD;
+  }
+
+  // Routes are expanded in order of increasing length, so the new chunk starts out with the
+  // shorter route (if any) that currently covers the slot.
+  const auto chunk = static_cast<uint32_t>( chunks_.size() / CHUNK_SIZE );
+  const uint32_t inherited = slot;
+  slot = CHILD | chunk;
+  chunks_.resize( chunks_.size() + CHUNK_SIZE, inherited );
+  return chunk;
+}
+
+RouteCache::RouteCache( const size_t size )
+  : entries_( size == 0 ? 0 : bit_ceil( max( size, size_t { 2 } ) ) ), shift_( 32 )
+{
+  if ( not entries_.empty() ) {
+    shift_ = 32 - countr_zero( entries_.size() );
+  }
+}
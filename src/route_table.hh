@@ -0,0 +1,110 @@
+#pragma once
+
+#include "address.hh"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct RouterEntry
+{
+  uint32_t route_prefix;
+  uint8_t prefix_length;
+  std::optional<Address> next_hop;
+  size_t interface_num;
+};
+
+// A longest-prefix-match table compiled from a list of routes.
+//
+// The table is a multibit trie with fixed strides of 16, 8 and 8 bits. Each
+// prefix is expanded to cover every slot of its last level, so a lookup is at
+// most three array reads: one in the 2^16-slot first level, and one in each of
+// up to two 256-slot child chunks.
+class RouteTable
+{
+private:
+  // A slot holds 0 (no route), the matching route's index + 1, or CHILD | the index of a child chunk.
+  static constexpr uint32_t CHILD = uint32_t { 1 } << 31;
+  static constexpr size_t CHUNK_SIZE = 256;
+
+  std::vector<uint32_t> first_level_ {};
+  std::vector<uint32_t> chunks_ {};
+
+  // Return the child chunk under `slot`, creating one that inherits the slot's route if needed.
+  uint32_t child( uint32_t& slot );
+
+public:
+  // Compile `routes`. Among routes with the same prefix, the one added first wins.
+  explicit RouteTable( const std::vector<RouterEntry>& routes = {} );
+
+  // The index in `routes` of the longest prefix matching `address`, if any
+  std::optional<size_t> lookup( uint32_t address ) const
+  {
+    uint32_t slot = first_level_[address >> 16];
+    if ( slot & CHILD ) {
+      slot = chunks_[( slot & ~CHILD ) * CHUNK_SIZE + ( ( address >> 8 ) & 0xff )];
+      if ( slot & CHILD ) {
+        slot = chunks_[( slot & ~CHILD ) * CHUNK_SIZE + ( address & 0xff )];
+      }
+    }
+    if ( slot == 0 ) {
+      return {};
+    }
+    return slot - 1;
+  }
+};
+
+// A direct-mapped cache of destination -> route index in front of a RouteTable.
+//
+// Entries are tagged with the generation of the table that produced them, so moving to a new
+// generation invalidates the whole cache without touching it. Misses (including "no route") fill
+// the slot the destination hashes to.
+class RouteCache
+{
+private:
+  struct Entry
+  {
+    uint64_t generation { NO_GENERATION };
+    uint32_t address {};
+    uint32_t route {};
+  };
+
+  static constexpr uint64_t NO_GENERATION = ~uint64_t { 0 };
+  static constexpr uint32_t NO_ROUTE = ~uint32_t { 0 };
+
+  std::vector<Entry> entries_;
+  unsigned shift_;
+  uint64_t hits_ {};
+  uint64_t misses_ {};
+
+public:
+  // A cache of `size` entries, rounded up to a power of two; 0 disables caching.
+  explicit RouteCache( size_t size );
+
+  // table.lookup( address ), answered from the cache when `generation` matches
+  std::optional<size_t> lookup( uint32_t address, uint64_t generation, const RouteTable& table )
+  {
+    if ( entries_.empty() ) {
+      ++misses_;
+      return table.lookup( address );
+    }
+
+    // Fibonacci hashing spreads neighbouring addresses across the table.
+    Entry& entry = entries_[( address * uint32_t { 0x9E3779B1 } ) >> shift_];
+    if ( entry.generation == generation and entry.address == address ) {
+      ++hits_;
+    } else {
+      ++misses_;
+      const auto match = table.lookup( address );
+      entry = { generation, address, match.has_value() ? static_cast<uint32_t>( *match ) : NO_ROUTE };
+    }
+
+    if ( entry.route == NO_ROUTE ) {
+      return {};
+    }
+    return entry.route;
+  }
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+};
@@ -1,7 +1,8 @@
 #include "router.hh"
 
-#include <iostream>
-#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
 
 using namespace std;
 
@@ -16,59 +17,142 @@ void Router::add_route( const uint32_t route_prefix,
                         const optional<Address> next_hop,
                         const size_t interface_num )
 {
-  cerr << "DEBUG: adding route " << Address::from_ipv4_numeric( route_prefix ).ip() << "/"
-       << static_cast<int>( prefix_length ) << " => " << ( next_hop.has_value() ? next_hop->ip() : "(direct)" )
-       << " on interface " << interface_num << "\n";
-
+  check_interface( interface_num );
+  const lock_guard lock { routes_mutex_ };
   routing_table_.push_back( RouterEntry( route_prefix, prefix_length, next_hop, interface_num ) );
+  stage_change();
 }
 
-void Router::forward_datagram( InternetDatagram& dgram )
+bool Router::remove_route( const uint32_t route_prefix, const uint8_t prefix_length )
 {
-  // Drop the datagram if TTL is 1 or less.
-  if ( dgram.header.ttl <= 1 ) {
-    return;
+  const lock_guard lock { routes_mutex_ };
+  const auto it = ranges::find_if( routing_table_, [&]( const RouterEntry& entry ) {
+    return entry.route_prefix == route_prefix and entry.prefix_length == prefix_length;
+  } );
+  if ( it == routing_table_.end() ) {
+    return false;
   }
 
-  // Longest prefix match to find the route.
-  uint32_t destination = dgram.header.dst;
-  int match_idx = -1;
-  int max_matched_len = -1;
-  for ( size_t i = 0; i < routing_table_.size(); i++ ) {
-    auto mask = routing_table_[i].prefix_length == 0
-                  ? 0
-                  : numeric_limits<int>::min() >> ( routing_table_[i].prefix_length - 1 );
-    if ( ( destination & mask ) == routing_table_[i].route_prefix
-         && max_matched_len < routing_table_[i].prefix_length ) {
-      match_idx = i;
-      max_matched_len = routing_table_[i].prefix_length;
+  routing_table_.erase( it );
+  stage_change();
+  return true;
+}
+
+bool Router::replace_route( const uint32_t route_prefix,
+                            const uint8_t prefix_length,
+                            const optional<Address> next_hop,
+                            const size_t interface_num )
+{
+  check_interface( interface_num );
+  const lock_guard lock { routes_mutex_ };
+  const auto it = ranges::find_if( routing_table_, [&]( const RouterEntry& entry ) {
+    return entry.route_prefix == route_prefix and entry.prefix_length == prefix_length;
+  } );
+  const bool replaced = it != routing_table_.end();
+  if ( replaced ) {
+    it->next_hop = next_hop;
+    it->interface_num = interface_num;
+  } else {
+    routing_table_.push_back( RouterEntry( route_prefix, prefix_length, next_hop, interface_num ) );
+  }
+
+  stage_change();
+  return replaced;
+}
+
+void Router::begin_batch()
+{
+  const lock_guard lock { routes_mutex_ };
+  batch_open_ = true;
+}
+
+uint64_t Router::commit()
+{
+  const lock_guard lock { routes_mutex_ };
+  batch_open_ = false;
+  publish();
+  return published_.load()->generation;
+}
+
+// The forwarding path indexes interfaces_ by each route's interface_num, so a route to a missing interface
+// is refused before it is staged.
+void Router::check_interface( const size_t interface_num ) const
+{
+  if ( interface_num >= interfaces_.size() ) {
+    throw runtime_error( "Router: route to nonexistent interface " + to_string( interface_num ) );
+  }
+}
+
+// Called with routes_mutex_ held after the staged rules change: outside a batch, the change is published now,
+// on the control plane's thread, so that route() never compiles a table.
+void Router::stage_change()
+{
+  if ( not batch_open_ ) {
+    publish();
+  }
+}
+
+// Called with routes_mutex_ held: compile the staged rules and swap them in.
+void Router::publish()
+{
+  vector<RouterEntry> routes = routing_table_;
+  RouteTable table { routes };
+  published_.store( make_shared<const RouteSnapshot>( next_generation_++, move( routes ), move( table ) ) );
+}
+
+// Classify a batch of datagrams, then send them grouped by output interface.
+void Router::forward_batch( const RouteSnapshot& routes )
+{
+  // Longest prefix match (through the route cache) for each datagram; drop it if its TTL is 1 or
+  // less or no route is found.
+  batch_routes_.clear();
+  for ( const auto& dgram : batch_ ) {
+    if ( dgram.header.ttl <= 1 ) {
+      batch_routes_.push_back( NO_ROUTE );
+      continue;
     }
+    const auto match_idx = route_cache_.lookup( dgram.header.dst, routes.generation, routes.table );
+    batch_routes_.push_back( match_idx.value_or( NO_ROUTE ) );
   }
 
-  // Drop the datagram if no route is found.
-  if ( match_idx == -1 ) {
-    return;
+  // Order the routed datagrams by output interface, keeping arrival order within each interface.
+  send_offsets_.assign( interfaces_.size() + 1, 0 );
+  for ( const size_t match_idx : batch_routes_ ) {
+    if ( match_idx != NO_ROUTE ) {
+      ++send_offsets_[routes.routes[match_idx].interface_num + 1];
+    }
+  }
+  partial_sum( send_offsets_.begin(), send_offsets_.end(), send_offsets_.begin() );
+  send_order_.resize( send_offsets_.back() );
+  for ( size_t i = 0; i < batch_.size(); ++i ) {
+    if ( batch_routes_[i] != NO_ROUTE ) {
+      send_order_[send_offsets_[routes.routes[batch_routes_[i]].interface_num]++] = i;
+    }
   }
 
-  // Process and send the datagram.
-  dgram.header.ttl -= 1;
-  dgram.header.compute_checksum();
-  auto next_hop = routing_table_[match_idx].next_hop;
-  auto interface_num = routing_table_[match_idx].interface_num;
-  if ( next_hop.has_value() ) {
-    interfaces_[interface_num].send_datagram( dgram, next_hop.value() );
-  } else {
-    interfaces_[interface_num].send_datagram( dgram, Address::from_ipv4_numeric( destination ) );
+  // Process and send the datagrams.
+  for ( const size_t i : send_order_ ) {
+    InternetDatagram& dgram = batch_[i];
+    dgram.header.decrement_ttl();
+    const auto& next_hop = routes.routes[batch_routes_[i]].next_hop;
+    const auto interface_num = routes.routes[batch_routes_[i]].interface_num;
+    if ( next_hop.has_value() ) {
+      interfaces_[interface_num].send_datagram( dgram, next_hop.value() );
+    } else {
+      interfaces_[interface_num].send_datagram( dgram, Address::from_ipv4_numeric( dgram.header.dst ) );
+    }
   }
 }
 
 void Router::route()
 {
-  // Route every incoming datagram on each interface.
+  // Hold one generation for the whole pass; a concurrent commit() takes effect on the next call.
+  const shared_ptr<const RouteSnapshot> routes = published_.load();
+
+  // Route every incoming datagram on each interface, up to MAX_BATCH at a time.
   for ( auto& interface : interfaces_ ) {
-    optional<InternetDatagram> maybe_dgram;
-    while ( ( maybe_dgram = interface.maybe_receive() ) != nullopt ) {
-      forward_datagram( maybe_dgram.value() );
+    while ( interface.receive_batch( batch_, MAX_BATCH ) > 0 ) {
+      forward_batch( *routes );
     }
   }
 }
@@ -1,7 +1,12 @@
 #pragma once
 
 #include "network_interface.hh"
+#include "route_table.hh"
 
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <queue>
 
@@ -46,30 +51,74 @@ public:
     datagrams_in_.pop();
     return datagram;
   }
+
+  // Move up to `max_datagrams` received datagrams into `batch` (replacing its contents)
+  // returns the number moved
+  size_t receive_batch( std::vector<InternetDatagram>& batch, size_t max_datagrams )
+  {
+    batch.clear();
+    while ( batch.size() < max_datagrams and not datagrams_in_.empty() ) {
+      batch.push_back( std::move( datagrams_in_.front() ) );
+      datagrams_in_.pop();
+    }
+    return batch.size();
+  }
 };
 
-struct RouterEntry
+// A compiled, immutable generation of the routing table. The forwarding path reads one of these
+// without locking while the control plane builds the next.
+struct RouteSnapshot
 {
-  uint32_t route_prefix;
-  uint8_t prefix_length;
-  std::optional<Address> next_hop;
-  size_t interface_num;
+  uint64_t generation {};
+  std::vector<RouterEntry> routes {};
+  RouteTable table {};
 };
 
 // A router that has multiple network interfaces and
 // performs longest-prefix-match routing between them.
+//
+// Route changes (add_route, remove_route, replace_route) are staged and then published as a new
+// RouteSnapshot. Outside a batch, each change is published by the call that makes it. Inside a batch
+// (begin_batch() ... commit()), they are published together by commit(). Either way the new table is
+// compiled on the calling (control-plane) thread and swapped in atomically; route() may keep running
+// concurrently on another thread, never takes the lock, and picks up the new generation on its next call.
 class Router
 {
 private:
   // The router's collection of network interfaces.
   std::vector<AsyncNetworkInterface> interfaces_ {};
 
-  // A list of routing rules.
+  // Guards the staged routing rules and batch state (control plane only).
+  std::mutex routes_mutex_ {};
+  // A list of routing rules, including changes not yet published.
   std::vector<RouterEntry> routing_table_ {};
+  bool batch_open_ { false };
+  uint64_t next_generation_ { 1 };
+
+  // The generation the forwarding path uses.
+  std::atomic<std::shared_ptr<const RouteSnapshot>> published_ { std::make_shared<const RouteSnapshot>() };
+
+  void check_interface( size_t interface_num ) const;
+  void stage_change();
+  void publish();
+
+  // Datagrams are pulled from each interface up to this many at a time.
+  static constexpr size_t MAX_BATCH = 64;
+  static constexpr size_t NO_ROUTE = std::numeric_limits<size_t>::max();
+
+  // Forwarding-path state, reused across batches.
+  RouteCache route_cache_;
+  std::vector<InternetDatagram> batch_ {};
+  std::vector<size_t> batch_routes_ {};
+  std::vector<size_t> send_offsets_ {};
+  std::vector<size_t> send_order_ {};
 
-  void forward_datagram( InternetDatagram& dgram );
+  void forward_batch( const RouteSnapshot& routes );
 
 public:
+  // route_cache_size: entries in the destination -> route cache used by route() (0 disables it)
+  explicit Router( size_t route_cache_size = 1024 ) : route_cache_( route_cache_size ) {}
+
   // Add an interface to the router
   // interface: an already-constructed network interface
   // returns the index of the interface after it has been added to the router
@@ -82,17 +131,42 @@ public:
   // Access an interface by index
   AsyncNetworkInterface& interface( size_t N ) { return interfaces_.at( N ); }
 
-  // Add a route (a forwarding rule)
+  // Add a route (a forwarding rule); throws if the router has no interface `interface_num`
   void add_route( uint32_t route_prefix,
                   uint8_t prefix_length,
                   std::optional<Address> next_hop,
                   size_t interface_num );
 
+  // Withdraw the route for exactly this prefix; returns false if there was none
+  bool remove_route( uint32_t route_prefix, uint8_t prefix_length );
+
+  // Point the route for exactly this prefix somewhere else, adding it if there was none;
+  // returns true if an existing route was replaced (throws, changing nothing, if there is no such interface)
+  bool replace_route( uint32_t route_prefix,
+                      uint8_t prefix_length,
+                      std::optional<Address> next_hop,
+                      size_t interface_num );
+
+  // Start a batch: route changes are held back until commit()
+  void begin_batch();
+
+  // Publish all staged route changes as one new generation (ending any open batch)
+  // returns the generation number now in effect
+  uint64_t commit();
+
+  // The generation of the routing table the forwarding path is currently using
+  uint64_t route_generation() const { return published_.load()->generation; }
+
+  // Lookups answered by the route cache, and lookups that went to the routing table
+  uint64_t route_cache_hits() const { return route_cache_.hits(); }
+  uint64_t route_cache_misses() const { return route_cache_.misses(); }
+
   // Route packets between the interfaces. For each interface, use the
   // maybe_receive() method to consume every incoming datagram and
   // send it on one of interfaces to the correct next hop. The router
   // chooses the outbound interface and next-hop as specified by the
   // route with the longest prefix_length that matches the datagram's
-  // destination address.
+  // destination address. Datagrams are taken from each interface in
+  // batches, and each batch is sent grouped by outbound interface.
   void route();
 };
@@ -0,0 +1,228 @@
+#include "sharded_router.hh"
+
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
+ShardedRouter::ShardedRouter( const size_t num_workers ) : num_workers_( max( num_workers, size_t { 1 } ) )
+{
+  workers_.resize( num_workers_ );
+  for ( auto& worker : workers_ ) {
+    worker.pending.resize( num_workers_ );
+  }
+  for ( size_t i = 0; i < num_workers_ * num_workers_; ++i ) {
+    handoffs_.push_back( make_unique<SPSCQueue<Handoff>>( QUEUE_CAPACITY ) );
+  }
+}
+
+ShardedRouter::~ShardedRouter()
+{
+  stop();
+}
+
+size_t ShardedRouter::add_interface( AsyncNetworkInterface&& interface )
+{
+  if ( running_ ) {
+    throw runtime_error( "ShardedRouter: cannot add an interface while running" );
+  }
+  ports_.push_back( make_unique<Port>( std::move( interface ) ) );
+  return ports_.size() - 1;
+}
+
+void ShardedRouter::add_route( const uint32_t route_prefix,
+                               const uint8_t prefix_length,
+                               const optional<Address> next_hop,
+                               const size_t interface_num )
+{
+  if ( running_ ) {
+    throw runtime_error( "ShardedRouter: cannot add a route while running" );
+  }
+  routing_table_.push_back( RouterEntry( route_prefix, prefix_length, next_hop, interface_num ) );
+}
+
+void ShardedRouter::start()
+{
+  if ( running_ ) {
+    return;
+  }
+
+  for ( const auto& route : routing_table_ ) {
+    if ( route.interface_num >= ports_.size() ) {
+      throw runtime_error( "ShardedRouter: route to nonexistent interface " + to_string( route.interface_num ) );
+    }
+  }
+  const uint64_t generation = routes_ ? routes_->generation + 1 : 1;
+  routes_ = make_shared<const RouteSnapshot>( generation, routing_table_, RouteTable { routing_table_ } );
+
+  for ( auto& worker : workers_ ) {
+    worker.interfaces.clear();
+  }
+  for ( size_t i = 0; i < ports_.size(); ++i ) {
+    workers_[i % num_workers_].interfaces.push_back( i );
+  }
+
+  running_ = true;
+  for ( size_t i = 0; i < num_workers_; ++i ) {
+    workers_[i].thread = thread { [this, i] { run_worker( i ); } };
+  }
+}
+
+void ShardedRouter::stop()
+{
+  running_ = false;
+  for ( auto& worker : workers_ ) {
+    if ( worker.thread.joinable() ) {
+      worker.thread.join();
+    }
+  }
+}
+
+void ShardedRouter::run_worker( const size_t worker_num )
+{
+  Worker& worker = workers_[worker_num];
+  auto last_tick = chrono::steady_clock::now();
+
+  // Datagrams that were waiting for another worker when the router last stopped go first.
+  for ( size_t owner = 0; owner < num_workers_; ++owner ) {
+    push_pending( worker_num, owner );
+  }
+
+  while ( running_.load( memory_order_relaxed ) ) {
+    bool busy = false;
+
+    // Frames from the links, and the datagrams they carry.
+    for ( const size_t i : worker.interfaces ) {
+      Port& port = *ports_[i];
+      while ( auto frame = port.from_link.pop() ) {
+        port.interface.recv_frame( *frame );
+        busy = true;
+      }
+      while ( port.interface.receive_batch( worker.batch, MAX_BATCH ) > 0 ) {
+        forward_batch( worker_num );
+        busy = true;
+      }
+    }
+
+    // Datagrams other workers routed to this worker's interfaces.
+    busy |= receive_handoffs( worker_num );
+
+    // Time passing on this worker's interfaces (ARP request retries and mapping expiry), in whole
+    // milliseconds; the remainder counts towards the next tick.
+    const auto elapsed = chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now() - last_tick );
+    if ( elapsed.count() > 0 ) {
+      last_tick += elapsed;
+      for ( const size_t i : worker.interfaces ) {
+        ports_[i]->interface.tick( elapsed.count() );
+      }
+    }
+
+    // Frames to the links.
+    for ( const size_t i : worker.interfaces ) {
+      busy |= flush( *ports_[i] );
+    }
+
+    if ( not busy ) {
+      this_thread::yield();
+    }
+  }
+}
+
+void ShardedRouter::forward_batch( const size_t worker_num )
+{
+  Worker& worker = workers_[worker_num];
+  const RouteSnapshot& routes = *routes_;
+
+  for ( auto& dgram : worker.batch ) {
+    // Drop the datagram if TTL is 1 or less, or if no route is found.
+    if ( dgram.header.ttl <= 1 ) {
+      continue;
+    }
+    const auto match_idx = worker.route_cache.lookup( dgram.header.dst, routes.generation, routes.table );
+    if ( not match_idx.has_value() ) {
+      continue;
+    }
+
+    dgram.header.decrement_ttl();
+    const RouterEntry& route = routes.routes[*match_idx];
+    const uint32_t next_hop = route.next_hop.has_value() ? route.next_hop->ipv4_numeric() : dgram.header.dst;
+    send( worker_num, { std::move( dgram ), next_hop, route.interface_num } );
+  }
+}
+
+// Send on the output interface if this worker owns it, otherwise pass the datagram to its owner.
+void ShardedRouter::send( const size_t worker_num, Handoff&& handoff )
+{
+  const size_t owner = handoff.interface_num % num_workers_;
+  if ( owner == worker_num ) {
+    ports_[handoff.interface_num]->interface.send_datagram( handoff.dgram,
+                                                            Address::from_ipv4_numeric( handoff.next_hop ) );
+    return;
+  }
+
+  auto& pending = workers_[worker_num].pending[owner];
+  if ( pending.empty() and handoffs_[worker_num * num_workers_ + owner]->push( std::move( handoff ) ) ) {
+    return;
+  }
+  pending.push_back( std::move( handoff ) );
+  push_pending( worker_num, owner );
+}
+
+// Move the worker's pending datagrams for `owner` into its handoff queue, in order. While the queue is full,
+// keep servicing this worker's own queues so that two workers waiting on each other still make progress. If the
+// router stops first, the rest stay pending until it starts again.
+void ShardedRouter::push_pending( const size_t worker_num, const size_t owner )
+{
+  auto& pending = workers_[worker_num].pending[owner];
+  auto& queue = *handoffs_[worker_num * num_workers_ + owner];
+  while ( not pending.empty() ) {
+    if ( queue.push( std::move( pending.front() ) ) ) {
+      pending.pop_front();
+      continue;
+    }
+    if ( not running_.load( memory_order_relaxed ) ) {
+      return;
+    }
+    receive_handoffs( worker_num );
+    for ( const size_t i : workers_[worker_num].interfaces ) {
+      flush( *ports_[i] );
+    }
+    this_thread::yield();
+  }
+}
+
+bool ShardedRouter::receive_handoffs( const size_t worker_num )
+{
+  bool received = false;
+  for ( size_t from = 0; from < num_workers_; ++from ) {
+    auto& queue = *handoffs_[from * num_workers_ + worker_num];
+    while ( auto handoff = queue.pop() ) {
+      ports_[handoff->interface_num]->interface.send_datagram( handoff->dgram,
+                                                               Address::from_ipv4_numeric( handoff->next_hop ) );
+      received = true;
+    }
+  }
+  return received;
+}
+
+// Move the port's outgoing frames to its link, as far as the link queue has room.
+bool ShardedRouter::flush( Port& port )
+{
+  bool flushed = false;
+  if ( port.unsent.has_value() ) {
+    if ( not port.to_link.push( std::move( *port.unsent ) ) ) {
+      return false;
+    }
+    port.unsent.reset();
+    flushed = true;
+  }
+
+  while ( auto frame = port.interface.maybe_send() ) {
+    if ( not port.to_link.push( std::move( *frame ) ) ) {
+      port.unsent = std::move( frame );
+      break;
+    }
+    flushed = true;
+  }
+  return flushed;
+}
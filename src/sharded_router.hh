@@ -0,0 +1,106 @@
+#pragma once
+
+#include "router.hh"
+#include "spsc_queue.hh"
+
+#include <deque>
+#include <thread>
+
+// A router whose interfaces are spread across worker threads.
+//
+// Each interface belongs to one worker (interface i to worker i % N), which alone receives from and
+// sends on it, so every datagram entering on one interface is forwarded, in order, by one thread. A
+// datagram routed to an interface owned by another worker is handed over through a lock-free
+// single-producer/single-consumer queue dedicated to that pair of workers, which keeps it in order
+// too. All workers share one read-only compiled routing table.
+//
+// Interfaces and routes are set up before start(). While the workers run, an interface is reached
+// only through deliver() (frames arriving from its link) and collect() (frames to put on its link);
+// each of those must be called by a single thread.
+class ShardedRouter
+{
+private:
+  // Datagrams are pulled from each interface up to this many at a time.
+  static constexpr size_t MAX_BATCH = 64;
+  static constexpr size_t QUEUE_CAPACITY = 1024;
+
+  struct Port
+  {
+    AsyncNetworkInterface interface;
+    SPSCQueue<EthernetFrame> from_link { QUEUE_CAPACITY };
+    SPSCQueue<EthernetFrame> to_link { QUEUE_CAPACITY };
+    // A frame that did not fit in to_link.
+    std::optional<EthernetFrame> unsent {};
+  };
+
+  // A routed datagram on its way to the worker that owns its output interface.
+  struct Handoff
+  {
+    InternetDatagram dgram;
+    uint32_t next_hop;
+    size_t interface_num;
+  };
+
+  struct Worker
+  {
+    std::vector<size_t> interfaces {};
+    // pending[to]: datagrams for worker `to` that did not fit in its handoff queue (kept across stop()), oldest
+    // first; later datagrams for that worker wait behind them.
+    std::vector<std::deque<Handoff>> pending {};
+    RouteCache route_cache { 1024 };
+    std::vector<InternetDatagram> batch {};
+    std::thread thread {};
+  };
+
+  // Ports (and the queues in them) stay put once added.
+  std::vector<std::unique_ptr<Port>> ports_ {};
+  std::vector<RouterEntry> routing_table_ {};
+
+  size_t num_workers_;
+  std::vector<Worker> workers_ {};
+  // handoffs_[from * num_workers_ + to] carries datagrams routed by worker `from` to an interface of worker `to`.
+  std::vector<std::unique_ptr<SPSCQueue<Handoff>>> handoffs_ {};
+  std::shared_ptr<const RouteSnapshot> routes_ {};
+  std::atomic<bool> running_ { false };
+
+  void run_worker( size_t worker_num );
+  void forward_batch( size_t worker_num );
+  void send( size_t worker_num, Handoff&& handoff );
+  void push_pending( size_t worker_num, size_t owner );
+  bool receive_handoffs( size_t worker_num );
+  bool flush( Port& port );
+
+public:
+  explicit ShardedRouter( size_t num_workers );
+  ~ShardedRouter();
+
+  ShardedRouter( const ShardedRouter& other ) = delete;
+  ShardedRouter& operator=( const ShardedRouter& other ) = delete;
+
+  // Add an interface to the router (before start())
+  // returns the index of the interface
+  size_t add_interface( AsyncNetworkInterface&& interface );
+
+  // Access an interface by index (only while the workers are stopped)
+  AsyncNetworkInterface& interface( size_t N ) { return ports_.at( N )->interface; }
+
+  // Add a route (before start()); the arguments are as for Router::add_route
+  void add_route( uint32_t route_prefix,
+                  uint8_t prefix_length,
+                  std::optional<Address> next_hop,
+                  size_t interface_num );
+
+  // Compile the routing table and start the worker threads
+  void start();
+
+  // Stop and join the worker threads; frames and datagrams still in flight stay queued
+  void stop();
+
+  // Hand a frame from the link to interface N; returns false (leaving `frame` untouched) if its queue is full
+  bool deliver( size_t N, EthernetFrame&& frame ) { return ports_.at( N )->from_link.push( std::move( frame ) ); }
+
+  // Take the next frame interface N has put on its link, if any
+  std::optional<EthernetFrame> collect( size_t N ) { return ports_.at( N )->to_link.pop(); }
+
+  size_t num_workers() const { return num_workers_; }
+};
@@ -20,9 +20,8 @@ void TCPReceiver::receive( TCPSenderMessage message, Reassembler& reassembler, W
   }
 
   // Extract data from the message and insert into the reassembler.
-  string data = message.payload;
   uint64_t first_index = message.seqno.unwrap( zero_point_.value(), checkpoint ) - ( !message.SYN );
-  reassembler.insert( first_index, data, message.FIN, inbound_stream );
+  reassembler.insert( first_index, std::move( message.payload ), message.FIN, inbound_stream );
 }
 
 TCPReceiverMessage TCPReceiver::send( const Writer& inbound_stream ) const
@@ -130,6 +130,14 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
   active_ = !outstanding_segments_.empty();
 }
 
+optional<uint64_t> TCPSender::ms_until_deadline() const
+{
+  if ( !active_ || outstanding_segments_.empty() ) {
+    return {};
+  }
+  return cur_RTO_ > timestamp_ ? cur_RTO_ - timestamp_ : 0;
+}
+
 void TCPSender::tick( const size_t ms_since_last_tick )
 {
   // Your code here.
@@ -51,6 +51,9 @@ public:
   /* Time has passed by the given # of milliseconds since the last time the tick() method was called. */
   void tick( uint64_t ms_since_last_tick );
 
+  /* How many more milliseconds of ticks until the retransmission timer expires (empty if it is not running) */
+  std::optional<uint64_t> ms_until_deadline() const;
+
   /* Accessors for use in testing */
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // How many consecutive *re*transmissions have happened?
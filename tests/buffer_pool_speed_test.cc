@@ -0,0 +1,169 @@
+#include "ethernet_frame.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace std::chrono;
+
+// Count every allocation, to see how many each packet costs.
+static size_t allocations = 0;
+
+void* operator new( size_t size )
+{
+  ++allocations;
+  if ( void* ptr = malloc( max( size, size_t { 1 } ) ) ) { // NOLINT(*-no-malloc)
+    return ptr;
+  }
+  throw bad_alloc {};
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+void operator delete( void* ptr, size_t /* size */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+static constexpr size_t ITERATIONS = 200000;
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+// An Ethernet frame carrying a TCP segment with a 1000-byte payload.
+EthernetFrame make_frame()
+{
+  TCPSegment seg;
+  seg.udinfo.src_port = 8080;
+  seg.udinfo.dst_port = 54321;
+  seg.sender_message.payload = string( 1000, 'x' );
+
+  InternetDatagram dgram;
+  dgram.header.src = 0xa9fe0001;
+  dgram.header.dst = 0x0a000002;
+  dgram.header.len = IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + seg.sender_message.payload.size();
+  dgram.header.compute_checksum();
+  seg.compute_checksum( dgram.header.pseudo_checksum() );
+  dgram.payload = serialize( seg );
+
+  EthernetFrame frame;
+  frame.header.type = EthernetHeader::TYPE_IPv4;
+  frame.payload = serialize( dgram );
+  return frame;
+}
+
+// The receive path before pooling: read into fresh strings for the headers and the rest, as the TAP adapter
+// did, and give each its own Buffer.
+bool receive_unpooled( FileDescriptor& fd, EthernetFrame& frame )
+{
+  vector<string> strs( 3 );
+  strs.at( 0 ).resize( EthernetHeader::LENGTH );
+  strs.at( 1 ).resize( IPv4Header::LENGTH );
+  fd.read( strs );
+
+  vector<Buffer> buffers;
+  ranges::transform( strs, back_inserter( buffers ), identity() );
+  return parse( frame, buffers );
+}
+
+bool receive_pooled( FileDescriptor& fd, EthernetFrame& frame )
+{
+  Buffer packet;
+  fd.read( packet );
+  return parse( frame, { move( packet ) } );
+}
+
+// Send a frame through a datagram socket pair and parse it all the way to the TCP segment, ITERATIONS times.
+void receive_speed_test( const string& name, bool ( *receive )( FileDescriptor&, EthernetFrame& ) )
+{
+  array<int, 2> fds {};
+  if ( socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) < 0 ) {
+    throw unix_error { "socketpair" };
+  }
+  FileDescriptor sender { fds[0] };
+  FileDescriptor receiver { fds[1] };
+  const vector<Buffer> wire = serialize( make_frame() );
+
+  size_t receive_allocations = 0;
+  duration<double> receive_duration {};
+  for ( size_t i = 0; i < ITERATIONS; ++i ) {
+    sender.write( wire );
+
+    const size_t allocations_before = allocations;
+    const auto start_time = steady_clock::now();
+    EthernetFrame frame;
+    InternetDatagram dgram;
+    TCPSegment seg;
+    if ( not receive( receiver, frame ) or not parse( dgram, frame.payload )
+         or not parse( seg, dgram.payload, dgram.header.pseudo_checksum() )
+         or seg.sender_message.payload.size() != 1000 ) {
+      throw runtime_error( name + " failed to receive the segment" );
+    }
+    receive_duration += steady_clock::now() - start_time;
+    receive_allocations += allocations - allocations_before;
+  }
+
+  report( name + " receive", static_cast<double>( receive_allocations ) / ITERATIONS, "allocations/packet" );
+  report( name + " receive", receive_duration.count() * 1e9 / ITERATIONS, "ns/packet" );
+}
+
+void serialize_speed_test()
+{
+  const EthernetFrame frame = make_frame();
+
+  size_t bytes = 0;
+  const size_t allocations_before = allocations;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < ITERATIONS; ++i ) {
+    for ( const auto& buffer : serialize( frame ) ) {
+      bytes += buffer.size();
+    }
+  }
+  const auto test_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+  const size_t serialize_allocations = allocations - allocations_before;
+
+  if ( bytes != ITERATIONS * ( EthernetHeader::LENGTH + IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + 1000 ) ) {
+    throw runtime_error( "unexpected frame length" );
+  }
+
+  report( "Frame serialize", static_cast<double>( serialize_allocations ) / ITERATIONS, "allocations/frame" );
+  report( "Frame serialize", test_duration.count() * 1e9 / ITERATIONS, "ns/frame" );
+}
+
+void program_body()
+{
+  receive_speed_test( "Unpooled", receive_unpooled );
+  receive_speed_test( "Pooled", receive_pooled );
+  serialize_speed_test();
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include "buffer.hh"
+#include "parser.hh"
+#include "reassembler.hh"
+
+#include <iostream>
+
+using namespace std;
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+// Does `view` point into the storage of `buffer`?
+bool shares( const string_view view, const Buffer& buffer )
+{
+  const string_view whole = buffer;
+  return view.data() >= whole.data() and view.data() + view.size() <= whole.data() + whole.size();
+}
+
+void slices()
+{
+  const Buffer whole { "hello, world" };
+  const Buffer world = whole.substr( 7 );
+  expect( string_view { world } == "world" and world.size() == 5, "substr(pos) gave the wrong bytes" );
+  expect( shares( world, whole ), "substr(pos) copied" );
+
+  const Buffer ell = whole.substr( 1, 3 );
+  expect( string_view { ell } == "ell" and string_view { ell.substr( 1, 100 ) } == "ll",
+          "substr(pos, n) gave the wrong bytes" );
+  expect( whole.substr( 12 ).empty(), "a slice at the end should be empty" );
+
+  bool threw = false;
+  try {
+    (void)whole.substr( 13 );
+  } catch ( const out_of_range& ) {
+    threw = true;
+  }
+  expect( threw, "substr past the end should throw" );
+
+  // Mutable access to a slice gives it its own string, leaving the original alone.
+  Buffer copy = world;
+  static_cast<string&>( copy ).append( "!" );
+  expect( string_view { copy } == "world!", "mutating a slice gave the wrong bytes" );
+  expect( string_view { whole } == "hello, world" and string_view { world } == "world", "mutated shared storage" );
+
+  // take() moves the string out only when nothing else shares it.
+  expect( Buffer { whole }.take() == "hello, world" and string_view { whole } == "hello, world",
+          "take() stole shared storage" );
+  expect( whole.substr( 0, 5 ).take() == "hello", "take() of a slice gave the wrong bytes" );
+}
+
+// Parsed payloads and reassembled bytes should still point into the buffer that was read.
+void zero_copy()
+{
+  const Buffer packet { "HEADER" + string( 1000, 'x' ) + "tail" };
+  Parser parser { { packet } };
+  uint32_t word {};
+  uint16_t half {};
+  parser.integer( word );
+  parser.integer( half );
+  vector<Buffer> rest;
+  parser.all_remaining( rest );
+  expect( rest.size() == 1 and string_view { rest.front() } == string_view { packet }.substr( 6 ),
+          "all_remaining gave the wrong bytes" );
+  expect( shares( rest.front(), packet ), "all_remaining copied the rest of a partly parsed buffer" );
+
+  Buffer joined;
+  Parser { { packet } }.all_remaining( joined );
+  expect( shares( joined, packet ), "all_remaining copied a single buffer" );
+
+  ByteStream stream { 2000, ByteStream::Storage::Chunked };
+  Reassembler reassembler;
+  reassembler.insert( 1000, packet.substr( 1006 ), true, stream.writer() );
+  reassembler.insert( 0, packet.substr( 6, 1000 ), false, stream.writer() );
+  expect( stream.reader().bytes_buffered() == 1004, "the reassembler should have written every byte" );
+  expect( shares( stream.reader().peek(), packet ), "in-order bytes were copied on their way to the stream" );
+  expect( stream.reader().peek_views().size() == 2 and stream.reader().peek_views().back() == "tail",
+          "stored bytes should follow the in-order ones" );
+  stream.reader().pop( 1004 );
+  expect( stream.reader().is_finished(), "the stream should be finished" );
+}
+
+// A few bytes (or none) should not keep a large buffer, such as a pooled packet, alive.
+void small_slices()
+{
+  const auto storage = make_shared<string>( 16384, 'x' );
+  const Buffer packet { storage };
+  const auto parse_rest = [&]( const size_t length ) {
+    Parser parser { { packet.substr( 0, length ) } };
+    uint32_t word {};
+    uint16_t half {};
+    parser.integer( word );
+    parser.integer( half );
+    Buffer rest;
+    parser.all_remaining( rest );
+    return rest;
+  };
+
+  const Buffer none = parse_rest( 6 );
+  expect( none.empty() and storage.use_count() == 2, "an empty remainder kept the packet alive" );
+  const Buffer few = parse_rest( 106 );
+  expect( few.size() == 100 and storage.use_count() == 2, "a small remainder kept the packet alive" );
+  const Buffer many = parse_rest( 1006 );
+  expect( many.size() == 1000 and shares( many, packet ), "a large remainder should share the packet" );
+
+  // The storage is held by `storage`, `packet` and `many` so far.
+  ByteStream stream { 2000, ByteStream::Storage::Chunked };
+  stream.writer().push( packet.substr( 0, 10 ) );
+  expect( stream.reader().peek() == string( 10, 'x' ) and storage.use_count() == 3,
+          "a small slice kept the packet alive in the stream" );
+  stream.writer().push( packet.substr( 0, 1000 ) );
+  expect( storage.use_count() == 4, "a large slice should be shared by the stream" );
+}
+
+int main()
+{
+  try {
+    slices();
+    zero_copy();
+    small_slices();
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
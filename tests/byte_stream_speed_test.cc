@@ -15,7 +15,8 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
                  const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
                  const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
                  const size_t write_size,  // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t read_size )  // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t read_size,   // NOLINT(bugprone-easily-swappable-parameters)
+                 const ByteStream::Storage storage = ByteStream::Storage::Ring )
 {
   // Generate the data to be written
   const string data = [&random_seed, &input_len] {
@@ -34,7 +35,7 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
     split_data.emplace( data.substr( i, write_size ) );
   }
 
-  ByteStream bs { capacity };
+  ByteStream bs { capacity, storage };
   string output_data;
   output_data.reserve( data.size() );
 
@@ -75,8 +76,9 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  cout << "ByteStream with capacity=" << capacity << ", write_size=" << write_size << ", read_size=" << read_size
-       << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+  cout << ( storage == ByteStream::Storage::Ring ? "Ring" : "Chunked" ) << " ByteStream with capacity=" << capacity
+       << ", write_size=" << write_size << ", read_size=" << read_size << " reached " << fixed << setprecision( 2 )
+       << gigabits_per_second << " Gbit/s.\n";
 
   debug_output << "             ByteStream throughput: " << fixed << setprecision( 2 ) << gigabits_per_second
                << " Gbit/s\n";
@@ -89,6 +91,20 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
 void program_body()
 {
   speed_test( 1e7, 32768, 789, 1500, 128 );
+
+  // Keep a large buffer full while sweeping the read size: the cost of a pop
+  // should not depend on how many bytes remain buffered behind it. (The sweep
+  // starts at 16-byte reads; one-byte reads measure the per-call overhead,
+  // which is too close to the speed floor under a loaded parallel ctest run.)
+  for ( size_t read_size = 16; read_size <= 65536; read_size *= 16 ) {
+    speed_test( 1e7, 1048576, 790, 1500, read_size );
+  }
+
+  // Compare the ring buffer against keeping pushed strings intact, at MTU-sized and large writes.
+  for ( const auto storage : { ByteStream::Storage::Ring, ByteStream::Storage::Chunked } ) {
+    speed_test( 1e7, 131072, 791, 1500, 65536, storage );
+    speed_test( 1e7, 131072, 791, 65536, 65536, storage );
+  }
 }
 
 int main()
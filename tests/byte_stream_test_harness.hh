@@ -16,8 +16,10 @@ static_assert( sizeof( Writer ) == sizeof( ByteStream ),
 class ByteStreamTestHarness : public TestHarness<ByteStream>
 {
 public:
-  ByteStreamTestHarness( std::string test_name, uint64_t capacity )
-    : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity } )
+  ByteStreamTestHarness( std::string test_name,
+                         uint64_t capacity,
+                         ByteStream::Storage storage = ByteStream::Storage::Ring )
+    : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity, storage } )
   {}
 
   size_t peek_size() { return object().reader().peek().size(); }
@@ -107,6 +109,31 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekViews : public Peek
+{
+  using Peek::Peek;
+
+  std::string description() const override
+  {
+    return "peek_views() covers exactly \"" + Printer::prettify( output_ ) + "\"";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    std::string got;
+    for ( const auto view : bs.reader().peek_views() ) {
+      if ( view.empty() ) {
+        throw ExpectationViolation { "Reader::peek_views() returned an empty string_view" };
+      }
+      got += view;
+    }
+    if ( got != output_ ) {
+      throw ExpectationViolation { "Expected \"" + Printer::prettify( output_ ) + "\" in buffer, " + " but found \""
+                                   + Printer::prettify( got ) + "\"" };
+    }
+  }
+};
+
 struct IsClosed : public ExpectBool<ByteStream>
 {
   using ExpectBool::ExpectBool;
@@ -0,0 +1,88 @@
+#include "checksum.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+// The straightforward byte-at-a-time checksum, used to check the optimized one.
+uint16_t reference_checksum( string_view data )
+{
+  uint64_t sum = 0; // wide enough not to overflow on the long inputs
+  for ( size_t i = 0; i < data.size(); ++i ) {
+    const uint16_t val = static_cast<uint8_t>( data[i] );
+    sum += i % 2 ? val : static_cast<uint16_t>( val << 8 );
+  }
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + static_cast<uint16_t>( sum );
+  }
+  return ~sum;
+}
+
+void correctness_test( const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string data( 70000, 0 );
+  generate( data.begin(), data.end(), [&] { return ud( rd ); } );
+
+  // Odd lengths, odd alignments, and odd split points between add() calls.
+  for ( size_t trial = 0; trial < 2000; ++trial ) {
+    const size_t offset = uniform_int_distribution<size_t> { 0, 63 }( rd );
+    const size_t max_len = trial < 1000 ? 200 : 69000;
+    const size_t len = uniform_int_distribution<size_t> { 0, max_len }( rd );
+    const string_view view = string_view { data }.substr( offset, len );
+
+    InternetChecksum check;
+    for ( size_t pos = 0; pos < view.size(); ) {
+      const size_t piece = uniform_int_distribution<size_t> { 1, 4096 }( rd );
+      check.add( view.substr( pos, piece ) );
+      pos += piece;
+    }
+
+    if ( check.value() != reference_checksum( view ) ) {
+      throw runtime_error( "InternetChecksum mismatch at offset=" + to_string( offset )
+                           + ", length=" + to_string( len ) );
+    }
+  }
+}
+
+// Inputs longer than one block of the SIMD kernels (512 KiB for SSE2, 1 MiB for AVX2), so that each lane is
+// folded into the sum between blocks. All-ones words make every lane as large as it can get.
+void long_input_test( const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string data( 3 * 1024 * 1024 + 777, 0 );
+  generate( data.begin(), data.end(), [&] { return ud( rd ); } );
+  const string ones( data.size(), static_cast<char>( 0xff ) );
+
+  for ( const string_view view : { string_view { data }, string_view { ones }, string_view { ones }.substr( 1 ) } ) {
+    InternetChecksum whole;
+    whole.add( view );
+
+    InternetChecksum pieces;
+    const size_t split = view.size() / 3 + 1;
+    pieces.add( view.substr( 0, split ) );
+    pieces.add( view.substr( split ) );
+
+    const uint16_t expected = reference_checksum( view );
+    if ( whole.value() != expected or pieces.value() != expected ) {
+      throw runtime_error( "InternetChecksum mismatch on a long input, length=" + to_string( view.size() ) );
+    }
+  }
+}
+
+int main()
+{
+  try {
+    correctness_test( 1371 );
+    long_input_test( 1371 );
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#include "checksum.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+
+void speed_test( const size_t input_len, const size_t total_bytes ) // NOLINT(bugprone-easily-swappable-parameters)
+{
+  const string data( input_len, 'x' );
+  const size_t iterations = max( size_t { 1 }, total_bytes / input_len );
+
+  uint16_t sink = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < iterations; ++i ) {
+    InternetChecksum check { static_cast<uint32_t>( i ) };
+    check.add( data );
+    sink ^= check.value();
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto gigabytes_per_second = static_cast<double>( iterations * input_len ) / test_duration.count() / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "InternetChecksum over " << input_len << "-byte inputs reached " << fixed << setprecision( 2 )
+       << gigabytes_per_second << " GB/s (checksum " << sink << ").\n";
+
+  debug_output << "             InternetChecksum throughput (" << input_len << " bytes): " << fixed
+               << setprecision( 2 ) << gigabytes_per_second << " GB/s\n";
+
+  if ( gigabytes_per_second < 0.1 ) {
+    throw runtime_error( "InternetChecksum did not meet minimum speed of 0.1 GB/s." );
+  }
+}
+
+void program_body()
+{
+  speed_test( 40, 1 << 29 );
+  speed_test( 1500, 1 << 30 );
+  speed_test( 65536, 1 << 30 );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
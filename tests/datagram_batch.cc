@@ -0,0 +1,71 @@
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+// Write five datagrams in one batch, and read them back in batches of three.
+void batches( const string& name, FileDescriptor& sender, FileDescriptor& receiver )
+{
+  vector<vector<Buffer>> packets;
+  for ( size_t i = 0; i < 5; ++i ) {
+    packets.push_back( { Buffer { "packet " }, Buffer { to_string( i ) } } );
+  }
+  expect( sender.write( span<const vector<Buffer>> { packets } ) == 5, name + ": not every datagram was written" );
+
+  receiver.set_blocking( false );
+  array<Buffer, 3> received;
+  expect( receiver.read( span { received } ) == 3, name + ": the first batch should be full" );
+  for ( size_t i = 0; i < 3; ++i ) {
+    expect( string_view { received.at( i ) } == "packet " + to_string( i ),
+            name + ": datagram " + to_string( i ) + " was wrong" );
+  }
+
+  expect( receiver.read( span { received } ) == 2, name + ": the second batch should hold the last two" );
+  expect( string_view { received.at( 1 ) } == "packet 4", name + ": the last datagram was wrong" );
+  expect( receiver.read( span { received } ) == 0, name + ": there should be nothing left to read" );
+
+  // A blocking fd reads no more than are ready either.
+  receiver.set_blocking( true );
+  expect( sender.write( span<const vector<Buffer>> { packets }.first( 1 ) ) == 1, name + ": single write failed" );
+  expect( receiver.read( span { received } ) == 1, name + ": a blocking read should return what is ready" );
+}
+
+void program_body()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+  FileDescriptor socket_sender { fds[0] };
+  FileDescriptor socket_receiver { fds[1] };
+  batches( "socket", socket_sender, socket_receiver );
+
+  // A pipe in packet mode keeps datagram boundaries, but is not a socket (like a TUN device).
+  CheckSystemCall( "pipe2", ::pipe2( fds.data(), O_DIRECT ) );
+  FileDescriptor pipe_receiver { fds[0] };
+  FileDescriptor pipe_sender { fds[1] };
+  batches( "packet pipe", pipe_sender, pipe_receiver );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#include "eventloop.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr size_t ROUNDS = 50000;
+static constexpr size_t BURST = 8; // datagrams sent per round (an AF_UNIX socket queues only 10 by default)
+static constexpr size_t PACKET_SIZE = 1040;
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+// Send bursts of datagrams from `sender` to `receiver`, and receive them with an EventLoop, either one datagram
+// per wakeup and write (as the TUN adapter did) or in batches.
+void batch_speed_test( const string& name, FileDescriptor& sender, FileDescriptor& receiver, const bool batched )
+{
+  // A non-socket fd (like a TUN device) needs one more read, which fails, to see that a batch is done.
+  const bool is_socket = [&] {
+    int type {};
+    socklen_t len = sizeof( type );
+    return ::getsockopt( receiver.fd_num(), SOL_SOCKET, SO_TYPE, &type, &len ) == 0;
+  }();
+
+  const vector<vector<Buffer>> burst( BURST, { Buffer { string( PACKET_SIZE, 'x' ) } } );
+  array<Buffer, BURST> packets;
+  receiver.set_blocking( false );
+
+  size_t received = 0;
+  size_t failed_reads = 0;
+  EventLoop loop;
+  loop.add_rule( "receive datagrams", receiver, Direction::In, [&] {
+    if ( batched ) {
+      const size_t count = receiver.read( span { packets } );
+      failed_reads += not is_socket and count < packets.size();
+      received += count;
+    } else {
+      receiver.read( packets.front() );
+      received += not packets.front().empty();
+    }
+  } );
+
+  size_t polls = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t round = 0; round < ROUNDS; ++round ) {
+    if ( batched ) {
+      if ( sender.write( span { burst } ) != BURST ) {
+        throw runtime_error( name + " dropped a datagram" );
+      }
+    } else {
+      for ( const auto& packet : burst ) {
+        sender.write( packet );
+      }
+    }
+
+    while ( received < ( round + 1 ) * BURST ) {
+      loop.wait_next_event( -1 );
+      ++polls;
+    }
+  }
+  const auto test_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  const size_t syscalls = polls + sender.write_count() + receiver.read_count() + failed_reads;
+  const string what = name + ( batched ? ", batched" : ", one per syscall" );
+  report( what, static_cast<double>( received ) / test_duration.count() / 1e6, "Mpackets/s" );
+  report( what, static_cast<double>( syscalls ) / static_cast<double>( received ), "syscalls/packet" );
+}
+
+void program_body()
+{
+  for ( const bool batched : { false, true } ) {
+    array<int, 2> fds {};
+    CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+    FileDescriptor socket_sender { fds[0] };
+    FileDescriptor socket_receiver { fds[1] };
+    batch_speed_test( "Datagram socket", socket_sender, socket_receiver, batched );
+
+    // A pipe in packet mode stands in for a TUN device: it keeps datagram boundaries, but is not a socket.
+    CheckSystemCall( "pipe2", ::pipe2( fds.data(), O_DIRECT ) );
+    FileDescriptor pipe_receiver { fds[0] };
+    FileDescriptor pipe_sender { fds[1] };
+    batch_speed_test( "Packet pipe", pipe_sender, pipe_receiver, batched );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+#include "eventloop.hh"
+#include "exception.hh"
+#include "socket.hh"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <sys/socket.h>
+
+using namespace std;
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+pair<FileDescriptor, FileDescriptor> socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+void rules( const EventLoop::Backend backend, const string& name )
+{
+  auto [ours, theirs] = socket_pair();
+  EventLoop loop { backend };
+
+  // Two rules on one fd: one always reads (it has no interest function), one writes while there is something to
+  // write.
+  string received;
+  size_t read_cancels = 0;
+  loop.add_rule(
+    loop.add_category( "read" ),
+    ours,
+    Direction::In,
+    [&] {
+      string data;
+      ours.read( data );
+      received += data;
+    },
+    {},
+    [&] { ++read_cancels; } );
+
+  string to_send;
+  size_t write_cancels = 0;
+  loop.add_rule(
+    "write",
+    ours,
+    Direction::Out,
+    [&] { to_send.erase( 0, ours.write( to_send ) ); },
+    [&] { return not to_send.empty(); },
+    [&] { ++write_cancels; } );
+
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, name + ": nothing should be ready" );
+
+  theirs.write( "hello" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and received == "hello",
+          name + ": the read rule should have read" );
+
+  // The write rule becomes interested, and then uninterested once it has written.
+  to_send = "world";
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and to_send.empty(),
+          name + ": the write rule should have written" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, name + ": the write rule should be idle" );
+  string data;
+  theirs.read( data );
+  expect( data == "world", name + ": the peer should have received the write" );
+
+  // Closing the peer hangs up both rules, which are handled in the same round: the read rule ends at EOF, and
+  // the write rule can never write again. Both get their cancel callbacks, and the loop exits.
+  theirs.close();
+  size_t events = 0;
+  while ( loop.wait_next_event( 0 ) != EventLoop::Result::Exit ) {
+    expect( ++events < 10, name + ": the loop should exit after the peer closes" );
+  }
+  expect( read_cancels == 1 and write_cancels == 1, name + ": both rules should be cancelled" );
+}
+
+void handles( const EventLoop::Backend backend, const string& name )
+{
+  auto [ours, theirs] = socket_pair();
+  EventLoop loop { backend };
+
+  size_t cancels = 0;
+  size_t reads = 0;
+  auto handle = loop.add_rule(
+    loop.add_category( "read" ),
+    ours,
+    Direction::In,
+    [&] {
+      string data;
+      ours.read( data );
+      ++reads;
+    },
+    {},
+    [&] { ++cancels; } );
+
+  bool interested = false;
+  loop.add_rule( "maybe read", theirs, Direction::In, [&] {}, [&] { return interested; } );
+
+  theirs.write( "x" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and reads == 1, name + ": should have read" );
+
+  // A rule cancelled by its handle goes away without calling its cancel callback; with the other rule
+  // uninterested, there is nothing left to wait for.
+  handle.cancel();
+  theirs.write( "y" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Exit, name + ": should exit with no interested rules" );
+  expect( reads == 1 and cancels == 0, name + ": the cancelled rule should not have run" );
+
+  interested = true;
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, name + ": an interested rule should wait" );
+}
+
+// Each ready rule runs up to its category's budget, and the categories take turns going first.
+void budgets( const EventLoop::Backend backend, const string& name )
+{
+  auto [bulk, bulk_peer] = socket_pair();
+  auto [capped, capped_peer] = socket_pair();
+  auto [interactive, interactive_peer] = socket_pair();
+  EventLoop loop { backend };
+
+  vector<string> log;
+  const auto reader = [&]( FileDescriptor& fd, const string& category ) {
+    return [&fd, &log, category] {
+      string data( 1000, 0 );
+      fd.read( data );
+      log.push_back( category );
+    };
+  };
+  const size_t bulk_id = loop.add_category( "bulk", { .iterations = 4 } );
+  const size_t capped_id = loop.add_category( "capped", { .iterations = 100, .bytes = 2500 } );
+  const size_t interactive_id = loop.add_category( "interactive" );
+  loop.add_rule( bulk_id, bulk, Direction::In, reader( bulk, "bulk" ) );
+  loop.add_rule( capped_id, capped, Direction::In, reader( capped, "capped" ) );
+  loop.add_rule( interactive_id, interactive, Direction::In, reader( interactive, "interactive" ) );
+
+  bulk_peer.write( string( 20000, 'b' ) );
+  capped_peer.write( string( 20000, 'c' ) );
+  interactive_peer.write( "x" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success, name + ": the rules should have run" );
+  expect( loop.stats( bulk_id ).calls == 4 and loop.stats( bulk_id ).bytes == 4000
+            and loop.stats( bulk_id ).deferred == 1,
+          name + ": the bulk rule should have run out of iterations" );
+  expect( loop.stats( capped_id ).calls == 3 and loop.stats( capped_id ).bytes == 3000
+            and loop.stats( capped_id ).deferred == 1,
+          name + ": the capped rule should have run out of bytes" );
+  expect( loop.stats( interactive_id ).calls == 1 and loop.stats( interactive_id ).bytes == 1,
+          name + ": the interactive rule should have run in the same wakeup" );
+
+  for ( const string first : { "capped", "interactive", "bulk" } ) {
+    log.clear();
+    interactive_peer.write( "x" );
+    expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and log.size() > 1 and log.front() == first,
+            name + ": the " + first + " rule should have gone first" );
+  }
+}
+
+// A budgeted rule runs again after a short read, and then finds the fd dry; it must see that nothing was read.
+void short_read( const EventLoop::Backend backend, const string& name )
+{
+  auto [ours, theirs] = socket_pair();
+  EventLoop loop { backend };
+
+  string received;
+  loop.add_rule( loop.add_category( "read", { .iterations = 4 } ), ours, Direction::In, [&] {
+    string data;
+    data.resize( 100 );
+    ours.read( data );
+    received += data;
+  } );
+
+  theirs.write( "hello" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Success and received == "hello",
+          name + ": the rule should have received only what was written, not \"" + received + "\"" );
+}
+
+// A non-fd rule that stays interested runs as many times as its budget allows on each call, not until it is done.
+void non_fd_budget( const EventLoop::Backend backend, const string& name )
+{
+  EventLoop loop { backend };
+  size_t count = 0;
+  const size_t category = loop.add_category( "count to 200", { .iterations = 50 } );
+  loop.add_rule( category, [&] { ++count; }, [&] { return count < 200; } );
+
+  for ( size_t expected = 50; expected <= 200; expected += 50 ) {
+    expect( loop.wait_next_event( -1 ) == EventLoop::Result::Success and count == expected,
+            name + ": the rule should have run " + to_string( expected ) + " times" );
+  }
+  expect( loop.wait_next_event( -1 ) == EventLoop::Result::Exit, name + ": the loop should exit when done" );
+  expect( loop.stats( category ).calls == 200 and loop.stats( category ).deferred == 3,
+          name + ": the rule should have been deferred between calls" );
+}
+
+// Timers run in deadline order, end the wait when they are due, and keep the loop from exiting.
+void timers( const EventLoop::Backend backend, const string& name )
+{
+  using namespace std::chrono;
+
+  auto [ours, theirs] = socket_pair();
+  EventLoop loop { backend };
+  loop.add_rule( loop.add_category( "idle" ), ours, Direction::In, [&] {
+    string data;
+    ours.read( data );
+  } );
+
+  const size_t category = loop.add_category( "timers" );
+  vector<int> fired;
+  const auto start_time = steady_clock::now();
+  loop.add_timer( category, start_time + 30ms, [&] { fired.push_back( 30 ); } );
+  loop.add_timer( category, start_time + 10ms, [&] { fired.push_back( 10 ); } );
+  loop.add_timer( category, start_time + 5ms, [&] { fired.push_back( 5 ); } ).cancel();
+
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and fired == vector { 10 },
+          name + ": the earliest timer should have ended the wait" );
+  expect( steady_clock::now() - start_time >= 10ms, name + ": the timer should not run before its deadline" );
+  expect( loop.wait_next_event( 1000 ) == EventLoop::Result::Success and fired == vector { 10, 30 },
+          name + ": the second timer should have ended the wait" );
+  expect( steady_clock::now() - start_time < 500ms, name + ": the waits should have ended at the timers" );
+  expect( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout and loop.stats( category ).calls == 2,
+          name + ": the cancelled timer should not have run" );
+
+  EventLoop timers_only { backend };
+  bool ran = false;
+  timers_only.add_timer( timers_only.add_category( "timer" ), steady_clock::now() + 5ms, [&] { ran = true; } );
+  expect( timers_only.wait_next_event( -1 ) == EventLoop::Result::Success and ran,
+          name + ": a pending timer should keep the loop waiting" );
+  expect( timers_only.wait_next_event( -1 ) == EventLoop::Result::Exit,
+          name + ": the loop should exit once its timers have run" );
+}
+
+int main()
+{
+  try {
+    for ( const auto& [backend, name] : { pair { EventLoop::Backend::Poll, "poll" },
+                                          pair { EventLoop::Backend::Epoll, "epoll" },
+                                          pair { EventLoop::Backend::IOUring, "io_uring" } } ) {
+      rules( backend, name );
+      handles( backend, name );
+      budgets( backend, name );
+      short_read( backend, name );
+      non_fd_budget( backend, name );
+      timers( backend, name );
+    }
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+#include "eventloop.hh"
+#include "exception.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr size_t ITERATIONS = 2000;
+static constexpr uint64_t BULK_BYTES = 256UL << 20;
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+FileDescriptor make_eventfd()
+{
+  return FileDescriptor { CheckSystemCall( "eventfd", ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) };
+}
+
+// Register `idle_fds` fds that never become ready and one that does, then time how long it takes from making the
+// hot fd ready to running its rule.
+void wakeup_speed_test( const EventLoop::Backend backend, const string& name, const size_t idle_fds )
+{
+  EventLoop loop { backend };
+
+  vector<FileDescriptor> idle;
+  idle.reserve( idle_fds );
+  const size_t idle_category = loop.add_category( "idle" );
+  for ( size_t i = 0; i < idle_fds; ++i ) {
+    idle.push_back( make_eventfd() );
+    loop.add_rule( idle_category, idle.back(), Direction::In, [] {
+      throw runtime_error( "an idle fd became ready" );
+    } );
+  }
+
+  FileDescriptor hot = make_eventfd();
+  size_t wakeups = 0;
+  loop.add_rule( loop.add_category( "hot" ), hot, Direction::In, [&] {
+    string counter( sizeof( uint64_t ), 0 );
+    hot.read( counter );
+    ++wakeups;
+  } );
+
+  const string one { "\1\0\0\0\0\0\0\0", sizeof( uint64_t ) };
+  duration<double> total {};
+  for ( size_t i = 0; i < ITERATIONS; ++i ) {
+    hot.write( one );
+    const auto start_time = steady_clock::now();
+    if ( loop.wait_next_event( -1 ) != EventLoop::Result::Success ) {
+      throw runtime_error( "wait_next_event did not run the hot rule" );
+    }
+    total += steady_clock::now() - start_time;
+  }
+
+  if ( wakeups != ITERATIONS ) {
+    throw runtime_error( "the hot rule ran " + to_string( wakeups ) + " times" );
+  }
+
+  report( name + " with " + to_string( idle_fds ) + " idle fds", total.count() * 1e6 / ITERATIONS, "us/wakeup" );
+}
+
+// Run a bulk transfer over a socketpair next to an interactive rule that is always ready, on one loop, with the
+// bulk reader's category given `budget`.
+void mixed_load_speed_test( const EventLoop::Backend backend, const string& name, const EventLoop::Budget& budget )
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds.data() ) );
+  FileDescriptor sender { fds[0] };
+  FileDescriptor receiver { fds[1] };
+  FileDescriptor ping = make_eventfd();
+
+  EventLoop loop { backend };
+  const string chunk( 65536, 'x' );
+  uint64_t sent = 0;
+  uint64_t received = 0;
+  loop.add_rule(
+    "bulk sender",
+    sender,
+    Direction::Out,
+    [&] { sent += sender.write( string_view { chunk }.substr( 0, min( chunk.size(), BULK_BYTES - sent ) ) ); },
+    [&] { return sent < BULK_BYTES; } );
+  loop.add_rule( loop.add_category( "bulk receiver", budget ), receiver, Direction::In, [&] {
+    Buffer data;
+    receiver.read( data );
+    received += data.size();
+  } );
+
+  const string one { "\1\0\0\0\0\0\0\0", sizeof( uint64_t ) };
+  const size_t interactive = loop.add_category( "interactive" );
+  loop.add_rule( interactive, ping, Direction::In, [&] {
+    string counter( sizeof( uint64_t ), 0 );
+    ping.read( counter );
+    ping.write( one );
+  } );
+  ping.write( one );
+
+  size_t wakeups = 0;
+  const auto start_time = steady_clock::now();
+  while ( received < BULK_BYTES ) {
+    loop.wait_next_event( -1 );
+    ++wakeups;
+  }
+  const duration<double> test_duration = steady_clock::now() - start_time;
+
+  if ( loop.stats( interactive ).calls != wakeups ) {
+    throw runtime_error( "the interactive rule missed a wakeup" );
+  }
+
+  const string what = name + ", bulk budget " + to_string( budget.iterations );
+  report( what, static_cast<double>( BULK_BYTES ) * 8 / test_duration.count() / 1e9, "Gbit/s" );
+  report( what, static_cast<double>( wakeups ) / static_cast<double>( BULK_BYTES >> 20 ), "wakeups/MiB" );
+  report( what + ", interactive rule", duration<double>( loop.stats( interactive ).max_delay ).count() * 1e6,
+          "us max delay" );
+}
+
+void program_body()
+{
+  for ( const size_t idle_fds : { 10, 1000, 10000 } ) {
+    wakeup_speed_test( EventLoop::Backend::Poll, "poll", idle_fds );
+    wakeup_speed_test( EventLoop::Backend::Epoll, "epoll", idle_fds );
+    if ( IOUring::supported() ) {
+      wakeup_speed_test( EventLoop::Backend::IOUring, "io_uring", idle_fds );
+    }
+  }
+
+  for ( const unsigned iterations : { 1, 16 } ) {
+    mixed_load_speed_test( EventLoop::Backend::Poll, "poll", { .iterations = iterations } );
+    mixed_load_speed_test( EventLoop::Backend::Epoll, "epoll", { .iterations = iterations } );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+#include "header_template.hh"
+#include "random.hh"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr uint32_t src_ip = 0x0a000002; // 10.0.0.2
+static constexpr uint32_t dst_ip = 0xa9fe0001; // 169.254.0.1
+static constexpr uint16_t src_port = 54321;
+static constexpr uint16_t dst_port = 8080;
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+size_t total_size( const vector<Buffer>& buffers )
+{
+  size_t ret = 0;
+  for ( const auto& buffer : buffers ) {
+    ret += buffer.size();
+  }
+  return ret;
+}
+
+string concat( const vector<Buffer>& buffers )
+{
+  string ret;
+  for ( const auto& buffer : buffers ) {
+    ret.append( buffer );
+  }
+  return ret;
+}
+
+// The datagram as built field by field: serialize the segment to checksum it, serialize it again as the
+// IP payload, then serialize the IP header to checksum it and once more to send it.
+vector<Buffer> reference_serialize( TCPSegment seg )
+{
+  seg.udinfo.src_port = src_port;
+  seg.udinfo.dst_port = dst_port;
+
+  InternetDatagram ip_dgram;
+  ip_dgram.header.src = src_ip;
+  ip_dgram.header.dst = dst_ip;
+  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 + seg.sender_message.payload.size();
+  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
+  ip_dgram.header.compute_checksum();
+  ip_dgram.payload = serialize( seg );
+  return serialize( ip_dgram );
+}
+
+TCPSegment random_segment( default_random_engine& rd, const size_t max_payload )
+{
+  TCPSegment seg;
+  seg.sender_message.seqno = Wrap32 { static_cast<uint32_t>( rd() ) };
+  seg.sender_message.SYN = rd() % 8 == 0;
+  seg.sender_message.FIN = rd() % 8 == 0;
+  seg.reset = rd() % 16 == 0;
+  if ( rd() % 4 ) {
+    seg.receiver_message.ackno = Wrap32 { static_cast<uint32_t>( rd() ) };
+  }
+  seg.receiver_message.window_size = rd();
+
+  string payload( rd() % ( max_payload + 1 ), 0 );
+  generate( payload.begin(), payload.end(), [&] { return rd(); } );
+  seg.sender_message.payload = std::move( payload );
+  return seg;
+}
+
+void correctness_test()
+{
+  auto rd = get_random_engine();
+  const TCPIPv4HeaderTemplate header_template { src_ip, src_port, dst_ip, dst_port };
+
+  for ( unsigned i = 0; i < 10000; ++i ) {
+    const TCPSegment seg = random_segment( rd, 1500 );
+    const string expected = concat( reference_serialize( seg ) );
+    if ( concat( header_template.serialize( seg ) ) != expected ) {
+      throw runtime_error( "TCPIPv4HeaderTemplate::serialize disagrees with field-by-field serialization" );
+    }
+    if ( concat( serialize( header_template.wrap( seg ) ) ) != expected ) {
+      throw runtime_error( "TCPIPv4HeaderTemplate::wrap disagrees with field-by-field serialization" );
+    }
+  }
+}
+
+void speed_test( const size_t payload_size )
+{
+  TCPSegment seg;
+  seg.sender_message.payload = string( payload_size, 'x' );
+  seg.receiver_message.ackno = Wrap32 { 1 };
+  seg.receiver_message.window_size = 65535;
+
+  const size_t iterations = 1000000;
+  size_t bytes = 0;
+
+  auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < iterations; ++i ) {
+    seg.sender_message.seqno = seg.sender_message.seqno + payload_size;
+    bytes += total_size( reference_serialize( seg ) );
+  }
+  const auto reference_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  const TCPIPv4HeaderTemplate header_template { src_ip, src_port, dst_ip, dst_port };
+  start_time = steady_clock::now();
+  for ( size_t i = 0; i < iterations; ++i ) {
+    seg.sender_message.seqno = seg.sender_message.seqno + payload_size;
+    bytes += total_size( header_template.serialize( seg ) );
+  }
+  const auto template_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  if ( bytes != 2 * iterations * ( TCPIPv4HeaderTemplate::LENGTH + payload_size ) ) {
+    throw runtime_error( "unexpected datagram length" );
+  }
+
+  const string what = "TCP/IPv4 serialization (" + to_string( payload_size ) + "-byte payload) ";
+  report( what + "field by field",
+          reference_duration.count() * 1e9 / static_cast<double>( iterations ),
+          "ns/segment" );
+  report( what + "from template",
+          template_duration.count() * 1e9 / static_cast<double>( iterations ),
+          "ns/segment" );
+}
+
+void program_body()
+{
+  correctness_test();
+  for ( const size_t payload_size : { 0, 1000 } ) {
+    speed_test( payload_size );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
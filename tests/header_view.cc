@@ -0,0 +1,149 @@
+#include "header_view.hh"
+#include "random.hh"
+#include "tcp_over_ip.hh"
+
+#include <iostream>
+
+using namespace std;
+
+static const Address local { "10.0.0.2", 54321 };
+static const Address peer { "169.254.0.1", 8080 };
+
+string concat( const vector<Buffer>& buffers )
+{
+  string ret;
+  for ( const auto& buffer : buffers ) {
+    ret.append( buffer );
+  }
+  return ret;
+}
+
+// A serialized datagram carrying a random segment, mostly between `local` and `peer`.
+string random_datagram( default_random_engine& rd )
+{
+  TCPSegment seg;
+  seg.udinfo.src_port = rd() % 4 ? peer.port() : rd();
+  seg.udinfo.dst_port = rd() % 4 ? local.port() : rd();
+  seg.sender_message.seqno = Wrap32 { static_cast<uint32_t>( rd() ) };
+  seg.sender_message.SYN = rd() % 4 == 0;
+  seg.sender_message.FIN = rd() % 8 == 0;
+  seg.reset = rd() % 16 == 0;
+  if ( rd() % 4 ) {
+    seg.receiver_message.ackno = Wrap32 { static_cast<uint32_t>( rd() ) };
+  }
+  seg.receiver_message.window_size = rd();
+  seg.sender_message.payload = string( rd() % 100, 'x' );
+
+  InternetDatagram dgram;
+  dgram.header.src = rd() % 4 ? peer.ipv4_numeric() : rd();
+  dgram.header.dst = rd() % 4 ? local.ipv4_numeric() : rd();
+  dgram.header.proto = rd() % 8 ? IPv4Header::PROTO_TCP : 17;
+  dgram.header.ttl = rd();
+  dgram.header.id = rd();
+  dgram.header.len = IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + seg.sender_message.payload.size();
+  seg.compute_checksum( dgram.header.pseudo_checksum() );
+  dgram.header.compute_checksum();
+  dgram.payload = serialize( seg );
+  return concat( serialize( dgram ) );
+}
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+// The views must read the same fields that IPv4Header::parse and TCPSegment::parse do, and accept
+// exactly the headers that IPv4Header::parse accepts.
+void views_match_parser()
+{
+  auto rd = get_random_engine();
+  for ( unsigned i = 0; i < 10000; ++i ) {
+    string wire = random_datagram( rd );
+    if ( i % 2 ) {
+      wire.at( rd() % IPv4Header::LENGTH ) ^= static_cast<char>( 1 << ( rd() % 8 ) );
+    }
+
+    InternetDatagram dgram;
+    const bool parsed = parse( dgram, { wire } );
+    const auto ip_view = IPv4HeaderView::parse( wire );
+    expect( parsed == ip_view.has_value(), "IPv4HeaderView and IPv4Header::parse disagree on validity" );
+    if ( not parsed ) {
+      continue;
+    }
+    expect( concat( serialize( ip_view->header() ) ) == concat( serialize( dgram.header ) ),
+            "IPv4HeaderView read different fields than IPv4Header::parse" );
+    expect( ip_view->header_length() == IPv4Header::LENGTH, "unexpected IPv4 header length" );
+
+    TCPSegment seg;
+    expect( parse( seg, dgram.payload, dgram.header.pseudo_checksum() ), "failed to parse TCP segment" );
+    const auto tcp_view = TCPHeaderView::parse( dgram.payload.front() );
+    expect( tcp_view.has_value(), "TCPHeaderView rejected a valid header" );
+    expect( tcp_view->src_port() == seg.udinfo.src_port and tcp_view->dst_port() == seg.udinfo.dst_port,
+            "TCPHeaderView read the wrong ports" );
+    expect( tcp_view->seqno() == seg.sender_message.seqno, "TCPHeaderView read the wrong seqno" );
+    expect( tcp_view->ACK() == seg.receiver_message.ackno.has_value()
+              and ( not tcp_view->ACK() or tcp_view->ackno() == seg.receiver_message.ackno.value() ),
+            "TCPHeaderView read the wrong ackno" );
+    expect( tcp_view->SYN() == seg.sender_message.SYN and tcp_view->FIN() == seg.sender_message.FIN
+              and tcp_view->RST() == seg.reset,
+            "TCPHeaderView read the wrong flags" );
+    expect( tcp_view->window_size() == seg.receiver_message.window_size and tcp_view->cksum() == seg.udinfo.cksum,
+            "TCPHeaderView read the wrong window or checksum" );
+  }
+
+  expect( not IPv4HeaderView::parse( string( IPv4Header::LENGTH - 1, 0 ) ), "accepted a truncated IPv4 header" );
+  expect( not TCPHeaderView::parse( string( TCPSegment::HEADER_LENGTH - 1, 0 ) ),
+          "accepted a truncated TCP header" );
+}
+
+// Unwrapping a serialized datagram, however it is split into buffers, must give the same result as
+// parsing it and unwrapping the InternetDatagram.
+void unwrap_matches_parser()
+{
+  auto rd = get_random_engine();
+  for ( const bool listening : { false, true } ) {
+    TCPOverIPv4Adapter adapter;
+    for ( unsigned i = 0; i < 10000; ++i ) {
+      const string wire = random_datagram( rd );
+      adapter.config_mut().source = local;
+      adapter.config_mut().destination = peer;
+      adapter.set_listening( listening );
+      optional<TCPSegment> expected;
+      InternetDatagram dgram;
+      if ( parse( dgram, { wire } ) ) {
+        expected = adapter.unwrap_tcp_in_ip( dgram );
+      }
+
+      // Whole, split after the IPv4 header as TunFD reads it, and split inside the IPv4 header.
+      const size_t split = ( rd() % 3 ) * ( IPv4Header::LENGTH / 2 );
+      adapter.config_mut().source = local;
+      adapter.config_mut().destination = peer;
+      adapter.set_listening( listening );
+      const auto actual
+        = split ? adapter.unwrap_tcp_in_ip( { wire.substr( 0, split ), wire.substr( split ) } )
+                : adapter.unwrap_tcp_in_ip( vector<Buffer> { wire } );
+
+      expect( actual.has_value() == expected.has_value(),
+              "unwrapping the serialized datagram gave a different result" );
+      if ( actual.has_value() ) {
+        expect( concat( serialize( *actual ) ) == concat( serialize( *expected ) ),
+                "unwrapping the serialized datagram gave a different segment" );
+      }
+    }
+  }
+}
+
+int main()
+{
+  try {
+    views_match_parser();
+    unwrap_matches_parser();
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+#include "buffer_pool.hh"
+#include "byte_stream.hh"
+#include "eventloop.hh"
+#include "exception.hh"
+#include "io_uring.hh"
+
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+static constexpr uint64_t TOTAL_BYTES = 1UL << 30;
+static constexpr uint64_t CHUNK_SIZE = 16384; // bytes written (from the ByteStream) or read at a time
+static constexpr double GIGABYTE = 1 << 30;
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+pair<FileDescriptor, FileDescriptor> socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+// User plus system CPU time used by this process so far, in seconds
+double cpu_seconds()
+{
+  rusage usage {};
+  CheckSystemCall( "getrusage", ::getrusage( RUSAGE_SELF, &usage ) );
+  const auto seconds = []( const timeval& t ) { return static_cast<double>( t.tv_sec ) + t.tv_usec / 1e6; };
+  return seconds( usage.ru_utime ) + seconds( usage.ru_stime );
+}
+
+// Keep the stream full of (refcounted, uncopied) chunks until TOTAL_BYTES have been pushed
+void refill( Writer& writer, const Buffer& chunk )
+{
+  while ( writer.available_capacity() > 0 and writer.bytes_pushed() < TOTAL_BYTES ) {
+    writer.push( chunk.substr( 0, min( chunk.size(), TOTAL_BYTES - writer.bytes_pushed() ) ) );
+  }
+}
+
+void report_transfer( const string& name, const uint64_t syscalls, const double cpu )
+{
+  report( name, static_cast<double>( syscalls ) / ( TOTAL_BYTES / GIGABYTE ), "syscalls/GB" );
+  report( name, cpu / ( TOTAL_BYTES / GIGABYTE ), "CPU s/GB" );
+}
+
+// Write the stream's peeked bytes to one end of a socketpair and read them from the other into pooled buffers,
+// with one rule for each and an EventLoop waiting between them.
+void eventloop_transfer( const EventLoop::Backend backend, const string& name )
+{
+  auto [sender, receiver] = socket_pair();
+  sender.set_blocking( false );
+  receiver.set_blocking( false );
+
+  ByteStream stream { 4 * CHUNK_SIZE, ByteStream::Storage::Chunked };
+  const Buffer chunk { string( CHUNK_SIZE, 'x' ) };
+  uint64_t received = 0;
+
+  EventLoop loop { backend };
+  loop.add_rule( "read", receiver, Direction::In, [&] {
+    Buffer data;
+    receiver.read( data );
+    received += data.size();
+  } );
+  loop.add_rule(
+    "write",
+    sender,
+    Direction::Out,
+    [&] {
+      refill( stream.writer(), chunk );
+      stream.reader().pop( sender.write( stream.reader().peek_views( CHUNK_SIZE ) ) );
+    },
+    [&] { return stream.reader().bytes_popped() < TOTAL_BYTES; } );
+
+  uint64_t waits = 0;
+  const double cpu_before = cpu_seconds();
+  while ( received < TOTAL_BYTES ) {
+    loop.wait_next_event( -1 );
+    ++waits;
+  }
+  const double cpu = cpu_seconds() - cpu_before;
+
+  report_transfer( name, waits + sender.write_count() + receiver.read_count(), cpu );
+}
+
+// The same transfer with an IOUring directly: each round submits a writev of the stream's peeked bytes linked to
+// a read into a pooled buffer, and waits for both, in one io_uring_enter.
+void io_uring_transfer()
+{
+  auto [sender, receiver] = socket_pair();
+  IOUring uring { 8 };
+
+  ByteStream stream { 4 * CHUNK_SIZE, ByteStream::Storage::Chunked };
+  const Buffer chunk { string( CHUNK_SIZE, 'x' ) };
+  uint64_t received = 0;
+
+  enum Operation : uint64_t
+  {
+    Write = 1,
+    Read
+  };
+
+  vector<iovec> iovecs;
+  const double cpu_before = cpu_seconds();
+  while ( received < TOTAL_BYTES ) {
+    // Write only once the last write has been read, so that neither the writev nor the read can block forever.
+    const bool write = received == stream.reader().bytes_popped() and received < TOTAL_BYTES;
+    if ( write ) {
+      refill( stream.writer(), chunk );
+      iovecs.clear();
+      for ( const auto view : stream.reader().peek_views( CHUNK_SIZE ) ) {
+        iovecs.push_back( { const_cast<char*>( view.data() ), view.size() } ); // NOLINT(*-const-cast)
+      }
+      uring.prepare_writev( sender.fd_num(), iovecs, Write, true );
+    }
+
+    shared_ptr<string> storage = BufferPool::packets().acquire();
+    storage->resize( CHUNK_SIZE );
+    uring.prepare_read( receiver.fd_num(), *storage, Read );
+    uring.submit( write ? 2 : 1 );
+
+    uring.drain( [&]( const uint64_t operation, const int32_t result ) {
+      if ( result == -ECANCELED ) {
+        return; // the read linked to a short write, which is retried in the next round
+      }
+      if ( result < 0 ) {
+        throw unix_error { operation == Write ? "writev" : "read", -result };
+      }
+      if ( operation == Write ) {
+        stream.reader().pop( result );
+      } else {
+        received += static_cast<uint64_t>( result );
+      }
+    } );
+  }
+  const double cpu = cpu_seconds() - cpu_before;
+
+  report_transfer( "io_uring, linked writev and read", uring.enters(), cpu );
+}
+
+void program_body()
+{
+  eventloop_transfer( EventLoop::Backend::Poll, "poll EventLoop" );
+  if ( IOUring::supported() ) {
+    eventloop_transfer( EventLoop::Backend::IOUring, "io_uring EventLoop" );
+    io_uring_transfer();
+  } else {
+    cout << "io_uring is unavailable; skipping its transfers.\n";
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#include "address.hh"
+#include "ipv4_header.hh"
+#include "random.hh"
+
+#include <iostream>
+
+using namespace std;
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+IPv4Header make_header( const uint8_t ttl )
+{
+  IPv4Header header;
+  header.src = Address { "10.0.0.2" }.ipv4_numeric();
+  header.dst = Address { "192.168.0.2" }.ipv4_numeric();
+  header.len = 1020;
+  header.ttl = ttl;
+  header.compute_checksum();
+  return header;
+}
+
+// The header with the ID that makes compute_checksum() give `cksum` (every value but 0xffff is possible)
+IPv4Header with_checksum( IPv4Header header, const uint16_t cksum )
+{
+  for ( uint32_t id = 0; id <= UINT16_MAX; ++id ) {
+    header.id = id;
+    header.compute_checksum();
+    if ( header.cksum == cksum ) {
+      return header;
+    }
+  }
+  throw runtime_error( "no ID gives checksum " + to_string( cksum ) );
+}
+
+// Does the RFC 1624 sum ~HC + ~m + m' for decrementing the TTL carry out of 16 bits?
+bool decrement_carries( const IPv4Header& header )
+{
+  const uint16_t old_word = ( static_cast<uint16_t>( header.ttl ) << 8 ) | header.proto;
+  const uint16_t new_word = ( static_cast<uint16_t>( header.ttl - 1 ) << 8 ) | header.proto;
+  return static_cast<uint16_t>( ~header.cksum ) + static_cast<uint16_t>( ~old_word ) + new_word > 0xffff;
+}
+
+// decrement_ttl() must leave the same checksum as recomputing it from scratch.
+void check_decrement( IPv4Header header, const string& what )
+{
+  IPv4Header expected = header;
+  expected.ttl -= 1;
+  expected.compute_checksum();
+
+  header.decrement_ttl();
+  expect( header.ttl == expected.ttl, what + ": wrong TTL" );
+  expect( header.cksum == expected.cksum,
+          what + ": decrement_ttl() gave checksum " + to_string( header.cksum ) + ", compute_checksum() gave "
+            + to_string( expected.cksum ) );
+}
+
+void decrement_ttl()
+{
+  for ( unsigned ttl = 1; ttl <= 255; ++ttl ) {
+    check_decrement( make_header( ttl ), "TTL " + to_string( ttl ) );
+  }
+
+  check_decrement( make_header( 1 ), "TTL 1 to 0" );
+
+  const IPv4Header carrying = make_header( 64 );
+  expect( decrement_carries( carrying ), "the TTL 64 header should carry" );
+  check_decrement( carrying, "a sum that carries" );
+
+  const IPv4Header not_carrying = with_checksum( make_header( 64 ), 0xfeff );
+  expect( not decrement_carries( not_carrying ), "the header with checksum 0xfeff should not carry" );
+  check_decrement( not_carrying, "a sum that does not carry" );
+
+  // compute_checksum() gives 0x0000, never 0xffff, for a header whose words sum to 0xffff; the update must too.
+  check_decrement( with_checksum( make_header( 64 ), 0x0000 ), "from checksum 0x0000" );
+  IPv4Header to_zero = with_checksum( make_header( 64 ), 0x0000 );
+  to_zero.ttl = 65;
+  to_zero.compute_checksum();
+  check_decrement( to_zero, "to checksum 0x0000" );
+}
+
+// update_checksum() for an arbitrary word (the ID) must agree with compute_checksum() too.
+void update_checksum()
+{
+  auto rd = get_random_engine();
+  for ( unsigned i = 0; i < 100000; ++i ) {
+    IPv4Header header = make_header( rd() );
+    header.id = rd();
+    header.compute_checksum();
+
+    IPv4Header expected = header;
+    expected.id = i % 2 ? rd() : ( i % 4 ? 0 : UINT16_MAX );
+    expected.compute_checksum();
+
+    header.update_checksum( header.id, expected.id );
+    expect( header.cksum == expected.cksum,
+            "update_checksum() disagreed with compute_checksum() changing ID " + to_string( header.id ) + " to "
+              + to_string( expected.id ) );
+  }
+}
+
+int main()
+{
+  try {
+    decrement_ttl();
+    update_checksum();
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -182,6 +182,47 @@ int main()
       test.execute( ExpectNoFrame {} );
     }
 
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "datagrams are dropped when their ARP request expires", local_eth, Address( "1.2.3.4", 0 ) };
+
+      const auto arp_request = make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) );
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.10" ), Address( "10.0.0.1", 0 ) } );
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.11" ), Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectFrame { arp_request } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( Tick { 4999 } );
+      test.execute( DroppedDatagrams { 0 } );
+      test.execute( Tick { 1 } );
+      // the request went unanswered, so the datagrams waiting on it are gone
+      test.execute( DroppedDatagrams { 2 } );
+
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.12" );
+      test.execute( SendDatagram { datagram, Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectFrame { arp_request } );
+      test.execute( ExpectNoFrame {} );
+
+      // a late reply releases only the datagram sent since
+      const EthernetAddress target_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          target_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP, // NOLINTNEXTLINE(*-suspicious-*)
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, target_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, target_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( Tick { 5000 } );
+      test.execute( DroppedDatagrams { 2 } );
+    }
+
     {
       const EthernetAddress local_eth = random_private_ethernet_address();
       NetworkInterfaceTestHarness test { "active mappings last 30 seconds", local_eth, Address( "4.3.2.1", 0 ) };
@@ -320,6 +361,48 @@ int main()
         serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
       test.execute( ExpectNoFrame {} );
     }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "pending datagrams are capped per next hop", local_eth, Address( "10.0.0.1", 0 ) };
+
+      vector<InternetDatagram> datagrams;
+      for ( unsigned i = 0; i < 100; ++i ) {
+        datagrams.push_back( make_datagram( "5.6.7.8", "13.12.11." + to_string( i ) ) );
+        test.execute( SendDatagram { datagrams.back(), Address( "10.0.0.5", 0 ) } );
+      }
+      const auto other = make_datagram( "5.6.7.8", "9.9.9.9" );
+      test.execute( SendDatagram { other, Address( "10.0.0.6", 0 ) } );
+
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.6" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // only the first 64 datagrams for 10.0.0.5 were kept, and only they are released by its reply
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.5", local_eth, "10.0.0.1" ) ) ),
+        {} } );
+      for ( unsigned i = 0; i < 64; ++i ) {
+        test.execute( ExpectFrame {
+          make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagrams[i] ) ) } );
+      }
+      test.execute( ExpectNoFrame {} );
+      test.execute( DroppedDatagrams { 36 } );
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << endl;
     return EXIT_FAILURE;
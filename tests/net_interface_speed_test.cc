@@ -0,0 +1,95 @@
+#include "arp_message.hh"
+#include "network_interface.hh"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+
+static const EthernetAddress local_eth { 0x02, 0, 0, 0, 0, 0x01 };
+static const Address local_ip { "10.0.0.1" };
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+// An ARP reply to the local interface from the neighbour at 10.x.y.z with the given index.
+EthernetFrame neighbour_reply( const uint32_t index )
+{
+  const EthernetAddress neighbour_eth { 0x02,
+                                       0,
+                                       0,
+                                       static_cast<uint8_t>( index >> 16 ),
+                                       static_cast<uint8_t>( index >> 8 ),
+                                       static_cast<uint8_t>( index ) };
+
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = neighbour_eth;
+  arp.sender_ip_address = ( uint32_t { 10 } << 24 ) + 2 + index;
+  arp.target_ethernet_address = local_eth;
+  arp.target_ip_address = local_ip.ipv4_numeric();
+
+  EthernetFrame frame;
+  frame.header.type = EthernetHeader::TYPE_ARP;
+  frame.header.src = neighbour_eth;
+  frame.header.dst = local_eth;
+  frame.payload = serialize( arp );
+  return frame;
+}
+
+// Tick every 10 ms (as TCPMinnowSocket does) with many learned neighbours, until all of them expire.
+void tick_speed_test( const uint32_t num_neighbours )
+{
+  NetworkInterface interface { local_eth, local_ip };
+  for ( uint32_t i = 0; i < num_neighbours; ++i ) {
+    interface.recv_frame( neighbour_reply( i ) );
+  }
+  while ( interface.maybe_send().has_value() ) {}
+
+  const size_t num_ticks = 30000 / 10;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < num_ticks; ++i ) {
+    interface.tick( 10 );
+  }
+  const auto test_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  // Every mapping has now expired, so sending to a neighbour must start with an ARP request.
+  InternetDatagram dgram;
+  interface.send_datagram( dgram, Address::from_ipv4_numeric( ( uint32_t { 10 } << 24 ) + 2 ) );
+  const auto frame = interface.maybe_send();
+  if ( not frame.has_value() or frame->header.type != EthernetHeader::TYPE_ARP ) {
+    throw runtime_error( "ARP mapping did not expire after 30 seconds" );
+  }
+
+  report( "NetworkInterface tick with " + to_string( num_neighbours ) + " neighbours",
+          test_duration.count() * 1e6 / static_cast<double>( num_ticks ),
+          "us/tick" );
+}
+
+void program_body()
+{
+  for ( const uint32_t num_neighbours : { 100, 10000 } ) {
+    tick_speed_test( num_neighbours );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
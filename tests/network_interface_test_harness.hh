@@ -135,6 +135,13 @@ struct Tick : public Action<NetworkInterface>
   explicit Tick( const size_t ms ) : _ms( ms ) {}
 };
 
+struct DroppedDatagrams : public ExpectNumber<NetworkInterface, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "dropped_datagrams"; }
+  uint64_t value( NetworkInterface& interface ) const override { return interface.dropped_datagrams(); }
+};
+
 inline std::string concat( std::vector<Buffer>& buffers )
 {
   return std::accumulate(
@@ -0,0 +1,108 @@
+#include "random.hh"
+#include "reassembler_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t NREPS = 32;
+static constexpr size_t NSEGS = 64;
+static constexpr size_t MAX_SEG_LEN = 200;
+
+int main()
+{
+  try {
+    {
+      ReassemblerTestHarness test { "bitmap holes", 8, Reassembler::Storage::Bitmap };
+
+      test.execute( Insert { "cd", 2 } );
+      test.execute( BytesPending( 2 ) );
+      test.execute( Insert { "g", 6 }.is_last() );
+      test.execute( BytesPending( 3 ) );
+      test.execute( Insert { "bcde", 1 } );
+      test.execute( BytesPending( 5 ) );
+      test.execute( BytesPushed( 0 ) );
+
+      test.execute( Insert { "ab", 0 } );
+      test.execute( BytesPending( 1 ) );
+      test.execute( ReadAll( "abcde" ) );
+      test.execute( IsFinished { false } );
+
+      test.execute( Insert { "f", 5 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "fg" ) );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap wraps around window", 4, Reassembler::Storage::Bitmap };
+
+      test.execute( Insert { "abc", 0 } );
+      test.execute( ReadAll( "abc" ) );
+      test.execute( Insert { "efgh", 4 } );
+      test.execute( BytesPending( 3 ) );
+      test.execute( Insert { "d", 3 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "defg" ) );
+      test.execute( Insert { "hij", 7 }.is_last() );
+      test.execute( ReadAll( "hij" ) );
+      test.execute( IsFinished { true } );
+    }
+
+    // The bitmap must agree with the map-based Reassembler on shuffled, overlapping segments
+    // in a window much smaller than the stream.
+    auto rd = get_random_engine();
+    for ( unsigned rep_no = 0; rep_no < NREPS; ++rep_no ) {
+      const size_t capacity = 64 + ( rd() % 1000 );
+      ReassemblerTestHarness sr {
+        "bitmap random test " + to_string( rep_no ), capacity, Reassembler::Storage::Bitmap };
+      ByteStream ref_stream { capacity };
+      Reassembler ref_reassembler { Reassembler::Storage::Map };
+
+      vector<tuple<size_t, size_t>> seq_size;
+      size_t offset = 0;
+      for ( unsigned i = 0; i < NSEGS; ++i ) {
+        const size_t size = 1 + ( rd() % ( MAX_SEG_LEN - 1 ) );
+        const size_t offs = min( offset, static_cast<size_t>( rd() ) % 64 );
+        seq_size.emplace_back( offset - offs, size + offs );
+        offset += size;
+      }
+
+      string d( offset, 0 );
+      generate( d.begin(), d.end(), [&] { return rd(); } );
+
+      // Deliver segments in batches of shuffled order (with retransmissions) until the stream finishes.
+      string ref_output;
+      while ( not ref_stream.reader().is_finished() ) {
+        shuffle( seq_size.begin(), seq_size.end(), rd );
+        for ( size_t i = 0; i < seq_size.size() / 2; ++i ) {
+          const auto [off, sz] = seq_size[i];
+          const bool is_last = off + sz == offset;
+          sr.execute( Insert { d.substr( off, sz ), off }.is_last( is_last ) );
+          ref_reassembler.insert( off, d.substr( off, sz ), is_last, ref_stream.writer() );
+          sr.execute( BytesPending( ref_reassembler.bytes_pending() ) );
+
+          string chunk;
+          read( ref_stream.reader(), ref_stream.reader().bytes_buffered(), chunk );
+          sr.execute( ReadAll( chunk ) );
+          ref_output += chunk;
+        }
+      }
+
+      sr.execute( IsFinished { true } );
+      if ( ref_output != d ) {
+        throw runtime_error( "reference Reassembler did not reproduce the stream" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -9,13 +9,15 @@
 #include <queue>
 #include <random>
 #include <tuple>
+#include <vector>
 
 using namespace std;
 using namespace std::chrono;
 
-void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t random_seed ) // NOLINT(bugprone-easily-swappable-parameters)
+void speed_test( const size_t num_chunks,  // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                 const Reassembler::Storage storage )
 {
   // Generate the data to be written
   const string data = [&] {
@@ -37,7 +39,7 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   }
 
   ByteStream stream { capacity };
-  Reassembler reassembler;
+  Reassembler reassembler { storage };
 
   string output_data;
   output_data.reserve( data.size() );
@@ -72,7 +74,8 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  cout << "Reassembler to ByteStream with capacity=" << capacity << " reached " << fixed << setprecision( 2 )
+  cout << ( storage == Reassembler::Storage::Map ? "Map" : "Bitmap" )
+       << " Reassembler to ByteStream with capacity=" << capacity << " reached " << fixed << setprecision( 2 )
        << gigabits_per_second << " Gbit/s.\n";
 
   debug_output << "             Reassembler throughput: " << fixed << setprecision( 2 ) << gigabits_per_second
@@ -83,9 +86,98 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   }
 }
 
+void reorder_speed_test( const size_t num_windows, // NOLINT(bugprone-easily-swappable-parameters)
+                         const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                         const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                         const Reassembler::Storage storage )
+{
+  default_random_engine rd { random_seed };
+
+  // Generate the data to be written
+  const string data = [&] {
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < num_windows * capacity; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  // Cover each window with small, overlapping segments, and deliver them in shuffled order
+  // (with some duplicated) so that many disjoint ranges are pending at once.
+  vector<tuple<uint64_t, string, bool>> split_data;
+  uniform_int_distribution<size_t> stride_dist { 16, 256 };
+  uniform_int_distribution<size_t> overlap_dist { 0, 512 };
+  bernoulli_distribution duplicate_dist { 0.25 };
+  for ( size_t window = 0; window < data.size(); window += capacity ) {
+    const size_t window_end = min( window + capacity, data.size() );
+    const auto window_begin = split_data.size();
+    for ( size_t i = window; i < window_end; ) {
+      const size_t len = min( stride_dist( rd ) + overlap_dist( rd ), window_end - i );
+      split_data.emplace_back( i, data.substr( i, len ), i + len == data.size() );
+      if ( duplicate_dist( rd ) ) {
+        split_data.push_back( split_data.back() );
+      }
+      i += min( len, stride_dist( rd ) );
+    }
+    shuffle( split_data.begin() + static_cast<ptrdiff_t>( window_begin ), split_data.end(), rd );
+  }
+
+  ByteStream stream { capacity };
+  Reassembler reassembler { storage };
+
+  string output_data;
+  output_data.reserve( data.size() );
+
+  size_t bytes_inserted = 0;
+  const auto start_time = steady_clock::now();
+  for ( auto& [first_index, segment, is_last] : split_data ) {
+    bytes_inserted += segment.size();
+    reassembler.insert( first_index, move( segment ), is_last, stream.writer() );
+
+    while ( stream.reader().bytes_buffered() ) {
+      output_data += stream.reader().peek();
+      stream.reader().pop( output_data.size() - stream.reader().bytes_popped() );
+    }
+  }
+
+  const auto stop_time = steady_clock::now();
+
+  if ( not stream.reader().is_finished() ) {
+    throw runtime_error( "Reassembler did not close ByteStream when finished" );
+  }
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto bytes_per_second = static_cast<double>( data.size() ) / test_duration.count();
+  auto bits_per_second = 8 * bytes_per_second;
+  auto gigabits_per_second = bits_per_second / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << ( storage == Reassembler::Storage::Map ? "Map" : "Bitmap" )
+       << " Reassembler to ByteStream with capacity=" << capacity << " under reordering (" << split_data.size()
+       << " segments, " << fixed << setprecision( 2 ) << static_cast<double>( bytes_inserted ) / data.size()
+       << "x overlap) reached " << gigabits_per_second << " Gbit/s.\n";
+
+  debug_output << "             Reassembler throughput under reordering: " << fixed << setprecision( 2 )
+               << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "Reassembler did not meet minimum speed of 0.1 Gbit/s under reordering." );
+  }
+}
+
 void program_body()
 {
-  speed_test( 10000, 1500, 1370 );
+  for ( const auto storage : { Reassembler::Storage::Map, Reassembler::Storage::Bitmap } ) {
+    speed_test( 10000, 1500, 1370, storage );
+    reorder_speed_test( 200, 65536, 1371, storage );
+  }
 }
 
 int main()
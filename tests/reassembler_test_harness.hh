@@ -28,10 +28,12 @@ struct ReassemblerByteStreamTestStep : public TestStep<StreamAndReassembler>
 class ReassemblerTestHarness : public TestHarness<StreamAndReassembler>
 {
 public:
-  ReassemblerTestHarness( std::string test_name, uint64_t capacity )
+  ReassemblerTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          Reassembler::Storage storage = Reassembler::Storage::Map )
     : TestHarness( move( test_name ),
                    "capacity=" + std::to_string( capacity ),
-                   { ByteStream { capacity }, Reassembler {} } )
+                   { ByteStream { capacity }, Reassembler { storage } } )
   {}
 
   template<std::derived_from<TestStep<ByteStream>> T>
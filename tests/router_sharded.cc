@@ -0,0 +1,315 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+#include "sharded_router.hh"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr unsigned DATAGRAMS_PER_FLOW = 300;
+
+uint32_t ip( const string& str )
+{
+  return Address { str }.ipv4_numeric();
+}
+
+EthernetAddress ethernet_address( const uint8_t id, const bool router )
+{
+  return { 0x02, 0, 0, 0, static_cast<uint8_t>( router ), id };
+}
+
+// A host that sends numbered datagrams and checks that each flow's datagrams arrive complete and in order.
+class Host
+{
+  string name_;
+  Address address_;
+  EthernetAddress ethernet_address_;
+  AsyncNetworkInterface interface_;
+  Address next_hop_;
+
+  // Flows this host sends: destination -> datagrams sent so far.
+  map<uint32_t, unsigned> sending_ {};
+  // Flows this host receives: (source, destination) -> datagrams received so far.
+  map<pair<uint32_t, uint32_t>, unsigned> receiving_ {};
+
+public:
+  Host( string name, const Address& address, const Address& next_hop, uint8_t id ) // NOLINT(*-easily-swappable-*)
+    : name_( std::move( name ) )
+    , address_( address )
+    , ethernet_address_( ethernet_address( id, false ) )
+    , interface_( ethernet_address_, address_ )
+    , next_hop_( next_hop )
+  {}
+
+  const Address& address() const { return address_; }
+  AsyncNetworkInterface& interface() { return interface_; }
+
+  // An ARP request from this host for `target`
+  EthernetFrame arp_request( const Address& target ) const
+  {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REQUEST;
+    arp.sender_ethernet_address = ethernet_address_;
+    arp.sender_ip_address = address_.ipv4_numeric();
+    arp.target_ip_address = target.ipv4_numeric();
+
+    EthernetFrame frame;
+    frame.header.type = EthernetHeader::TYPE_ARP;
+    frame.header.src = ethernet_address_;
+    frame.header.dst = ETHERNET_BROADCAST;
+    frame.payload = serialize( arp );
+    return frame;
+  }
+
+  void send_flow( const Address& destination ) { sending_.insert( { destination.ipv4_numeric(), 0 } ); }
+  void expect_flow( const Address& source, const Address& destination )
+  {
+    receiving_.insert( { { source.ipv4_numeric(), destination.ipv4_numeric() }, 0 } );
+  }
+
+  // Send up to `burst` more datagrams on each flow.
+  void send( const unsigned burst )
+  {
+    for ( auto& [destination, sent] : sending_ ) {
+      for ( unsigned i = 0; i < burst and sent < DATAGRAMS_PER_FLOW; ++i, ++sent ) {
+        InternetDatagram dgram;
+        dgram.header.src = address_.ipv4_numeric();
+        dgram.header.dst = destination;
+        dgram.payload.emplace_back( to_string( sent ) );
+        dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + dgram.payload.back().size();
+        dgram.header.compute_checksum();
+        interface_.send_datagram( dgram, next_hop_ );
+      }
+    }
+  }
+
+  void receive()
+  {
+    while ( auto dgram = interface_.maybe_receive() ) {
+      const auto flow = receiving_.find( { dgram->header.src, dgram->header.dst } );
+      if ( flow == receiving_.end() ) {
+        throw runtime_error( "Host " + name_
+                             + " received unexpected Internet datagram: " + dgram->header.to_string() );
+      }
+      const string sequence = concat( dgram->payload );
+      if ( sequence != to_string( flow->second ) ) {
+        throw runtime_error( "Host " + name_ + " expected datagram " + to_string( flow->second ) + " from "
+                             + Address::from_ipv4_numeric( dgram->header.src ).ip() + " but received "
+                             + sequence );
+      }
+      ++flow->second;
+    }
+  }
+
+  bool done() const
+  {
+    return ranges::all_of( receiving_, []( const auto& flow ) { return flow.second == DATAGRAMS_PER_FLOW; } );
+  }
+
+  string progress() const
+  {
+    string ret;
+    for ( const auto& [flow, received] : receiving_ ) {
+      ret += name_ + " received " + to_string( received ) + " from "
+             + Address::from_ipv4_numeric( flow.first ).ip() + "; ";
+    }
+    return ret;
+  }
+};
+
+// The topology of tests/router.cc, with the router's interfaces spread over several workers.
+class ShardedNetwork
+{
+  ShardedRouter router_;
+  unordered_map<string, Host> hosts_ {};
+  // Links: router interface (and its address) -> hosts attached to it.
+  vector<tuple<size_t, Address, vector<string>>> links_ {};
+
+  static void carry( ShardedRouter& router, const size_t interface_num, vector<Host*>& hosts )
+  {
+    for ( Host* host : hosts ) {
+      while ( auto frame = host->interface().maybe_send() ) {
+        for ( Host* other : hosts ) {
+          if ( other != host ) {
+            other->interface().recv_frame( *frame );
+          }
+        }
+        while ( not router.deliver( interface_num, std::move( *frame ) ) ) {}
+      }
+    }
+    while ( auto frame = router.collect( interface_num ) ) {
+      for ( Host* host : hosts ) {
+        host->interface().recv_frame( *frame );
+      }
+    }
+  }
+
+public:
+  explicit ShardedNetwork( const size_t num_workers ) : router_( num_workers )
+  {
+    vector<Address> addresses;
+    const auto add = [&]( const string& address, uint8_t id ) {
+      addresses.emplace_back( address );
+      return router_.add_interface( { ethernet_address( id, true ), Address { address } } );
+    };
+    const size_t default_id = add( "171.67.76.46", 0 );
+    const size_t eth0_id = add( "10.0.0.1", 1 );
+    const size_t eth1_id = add( "172.16.0.1", 2 );
+    const size_t eth2_id = add( "192.168.0.1", 3 );
+    const size_t uun3_id = add( "198.178.229.1", 4 );
+    const size_t hs4_id = add( "143.195.0.2", 5 );
+    const size_t mit5_id = add( "128.30.76.255", 6 );
+
+    hosts_.insert( { "applesauce", { "applesauce", Address { "10.0.0.2" }, Address { "10.0.0.1" }, 1 } } );
+    hosts_.insert( { "default_router", { "default_router", Address { "171.67.76.1" }, Address { "0" }, 2 } } );
+    hosts_.insert( { "cherrypie", { "cherrypie", Address { "192.168.0.2" }, Address { "192.168.0.1" }, 3 } } );
+    hosts_.insert( { "hs_router", { "hs_router", Address { "143.195.0.1" }, Address { "0" }, 4 } } );
+    hosts_.insert( { "dm42", { "dm42", Address { "198.178.229.42" }, Address { "198.178.229.1" }, 5 } } );
+    hosts_.insert( { "dm43", { "dm43", Address { "198.178.229.43" }, Address { "198.178.229.1" }, 6 } } );
+
+    links_ = { { default_id, addresses[default_id], { "default_router" } },
+               { eth0_id, addresses[eth0_id], { "applesauce" } },
+               { eth2_id, addresses[eth2_id], { "cherrypie" } },
+               { uun3_id, addresses[uun3_id], { "dm42", "dm43" } },
+               { hs4_id, addresses[hs4_id], { "hs_router" } } };
+
+    router_.add_route( ip( "0.0.0.0" ), 0, host( "default_router" ).address(), default_id );
+    router_.add_route( ip( "10.0.0.0" ), 8, {}, eth0_id );
+    router_.add_route( ip( "172.16.0.0" ), 16, {}, eth1_id );
+    router_.add_route( ip( "192.168.0.0" ), 24, {}, eth2_id );
+    router_.add_route( ip( "198.178.229.0" ), 24, {}, uun3_id );
+    router_.add_route( ip( "143.195.0.0" ), 17, host( "hs_router" ).address(), hs4_id );
+    router_.add_route( ip( "143.195.128.0" ), 18, host( "hs_router" ).address(), hs4_id );
+    router_.add_route( ip( "143.195.192.0" ), 19, host( "hs_router" ).address(), hs4_id );
+    router_.add_route( ip( "128.30.76.255" ), 16, Address { "128.30.0.1" }, mit5_id );
+  }
+
+  Host& host( const string& name ) { return hosts_.at( name ); }
+
+  void flow( const string& source, const string& destination )
+  {
+    flow( source, host( destination ).address(), destination );
+  }
+
+  void flow( const string& source, const Address& destination, const string& receiver )
+  {
+    host( source ).send_flow( destination );
+    host( receiver ).expect_flow( host( source ).address(), destination );
+  }
+
+  // Run the router's workers while this thread plays the part of the links and hosts, stopping and restarting
+  // them every `restart_every` rounds (if not 0): datagrams in flight must survive the stops.
+  void simulate( const unsigned restart_every = 0 )
+  {
+    vector<pair<size_t, vector<Host*>>> links;
+    for ( const auto& [interface_num, address, names] : links_ ) {
+      links.emplace_back( interface_num, vector<Host*> {} );
+      for ( const auto& name : names ) {
+        links.back().second.push_back( &host( name ) );
+      }
+    }
+
+    // Resolve every host and router interface on each link before traffic starts, so that no
+    // datagrams pile up (and get dropped) behind ARP.
+    for ( const auto& [interface_num, address, names] : links_ ) {
+      for ( const auto& name : names ) {
+        router_.interface( interface_num ).recv_frame( host( name ).arp_request( address ) );
+      }
+      while ( auto frame = router_.interface( interface_num ).maybe_send() ) {
+        for ( const auto& name : names ) {
+          host( name ).interface().recv_frame( *frame );
+        }
+      }
+    }
+
+    router_.start();
+    const auto deadline = steady_clock::now() + seconds { 20 };
+    for ( unsigned round = 1; not ranges::all_of( hosts_, []( const auto& h ) { return h.second.done(); } );
+          ++round ) {
+      if ( restart_every and round % restart_every == 0 ) {
+        router_.stop();
+        router_.start();
+      }
+
+      if ( steady_clock::now() > deadline ) {
+        router_.stop();
+        string progress;
+        for ( const auto& [name, h] : hosts_ ) {
+          progress += h.progress();
+        }
+        throw runtime_error( "timed out: " + progress );
+      }
+
+      for ( auto& [name, h] : hosts_ ) {
+        h.send( 8 );
+      }
+      for ( auto& [interface_num, hosts] : links ) {
+        carry( router_, interface_num, hosts );
+      }
+      for ( auto& [name, h] : hosts_ ) {
+        h.receive();
+      }
+    }
+    router_.stop();
+  }
+};
+
+void sharded_network( const size_t num_workers, const unsigned restart_every = 0 )
+{
+  ShardedNetwork network { num_workers };
+
+  network.flow( "applesauce", "cherrypie" );
+  network.flow( "cherrypie", "applesauce" );
+  network.flow( "applesauce", Address { "1.2.3.4" }, "default_router" );
+  network.flow( "applesauce", Address { "143.195.131.17" }, "hs_router" );
+  network.flow( "cherrypie", Address { "143.195.193.52" }, "hs_router" );
+  network.flow( "cherrypie", Address { "143.195.224.0" }, "default_router" );
+  network.flow( "dm42", "dm43" );
+  network.flow( "dm43", "applesauce" );
+
+  network.simulate( restart_every );
+}
+
+// The workers tick the interfaces they own, so that mappings age out (and ARP requests are retried) while the
+// router runs.
+void worker_ticks( const size_t num_workers )
+{
+  ShardedRouter router { num_workers };
+  const Address router_address { "10.0.0.1" };
+  const size_t interface_num = router.add_interface( { ethernet_address( 1, true ), router_address } );
+  const Host host { "applesauce", Address { "10.0.0.2" }, router_address, 1 };
+  router.interface( interface_num ).recv_frame( host.arp_request( router_address ) );
+
+  const auto start_time = steady_clock::now();
+  router.start();
+  this_thread::sleep_for( milliseconds { 100 } );
+  router.stop();
+  const auto elapsed = duration_cast<milliseconds>( steady_clock::now() - start_time );
+
+  const auto until_expiry = router.interface( interface_num ).ms_until_deadline();
+  if ( not until_expiry or *until_expiry + 50 > 30000 or *until_expiry + elapsed.count() < 30000 ) {
+    throw runtime_error( "the learned mapping should have aged by about " + to_string( elapsed.count() )
+                         + " ms while the workers ran" );
+  }
+}
+
+int main()
+{
+  try {
+    for ( const size_t num_workers : { 1, 2, 3, 7 } ) {
+      sharded_network( num_workers );
+      sharded_network( num_workers, 5 );
+      worker_ticks( num_workers );
+    }
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,394 @@
+#include "arp_message.hh"
+#include "router.hh"
+#include "sharded_router.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+static const EthernetAddress router_eth0 { 0x02, 0, 0, 0, 0, 0x01 };
+static const EthernetAddress router_eth1 { 0x02, 0, 0, 0, 0, 0x02 };
+static const EthernetAddress host_eth { 0x02, 0, 0, 0, 0, 0x03 };
+
+// A datagram from 10.0.0.2 to `destination` (by default 192.168.0.2), framed for the router's first interface.
+EthernetFrame make_frame( const uint32_t destination = Address { "192.168.0.2" }.ipv4_numeric() )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "10.0.0.2" }.ipv4_numeric();
+  dgram.header.dst = destination;
+  dgram.payload.emplace_back( string( 1000, 'x' ) );
+  dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + dgram.payload.back().size();
+  dgram.header.compute_checksum();
+
+  EthernetFrame frame;
+  frame.header.type = EthernetHeader::TYPE_IPv4;
+  frame.header.src = host_eth;
+  frame.header.dst = router_eth0;
+  frame.payload = serialize( dgram );
+  return frame;
+}
+
+// Tell the router's second interface the Ethernet address of 192.168.0.2.
+EthernetFrame make_arp_reply()
+{
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = host_eth;
+  arp.sender_ip_address = Address { "192.168.0.2" }.ipv4_numeric();
+  arp.target_ethernet_address = router_eth1;
+  arp.target_ip_address = Address { "192.168.0.1" }.ipv4_numeric();
+
+  EthernetFrame frame;
+  frame.header.type = EthernetHeader::TYPE_ARP;
+  frame.header.src = host_eth;
+  frame.header.dst = router_eth1;
+  frame.payload = serialize( arp );
+  return frame;
+}
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+// Compare recomputing the header checksum from scratch against the RFC 1624 update.
+void ttl_speed_test( const size_t iterations )
+{
+  IPv4Header header;
+  header.src = Address { "10.0.0.2" }.ipv4_numeric();
+  header.dst = Address { "192.168.0.2" }.ipv4_numeric();
+  header.len = 1020;
+
+  for ( unsigned ttl = 1; ttl <= 255; ++ttl ) {
+    header.ttl = ttl;
+    header.compute_checksum();
+    IPv4Header expected = header;
+    expected.ttl -= 1;
+    expected.compute_checksum();
+    header.decrement_ttl();
+    if ( header.cksum != expected.cksum ) {
+      throw runtime_error( "incremental checksum update disagrees with compute_checksum()" );
+    }
+  }
+
+  // Count down from the maximum TTL, restoring the header (and its valid checksum) when it runs out.
+  header.ttl = 255;
+  header.compute_checksum();
+  const IPv4Header fresh = header;
+
+  auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < iterations; ++i ) {
+    if ( header.ttl == 1 ) {
+      header = fresh;
+    }
+    header.ttl -= 1;
+    header.compute_checksum();
+  }
+  const auto full_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  header = fresh;
+  start_time = steady_clock::now();
+  for ( size_t i = 0; i < iterations; ++i ) {
+    if ( header.ttl == 1 ) {
+      header = fresh;
+    }
+    header.decrement_ttl();
+  }
+  const auto incremental_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  report( "TTL decrement with full checksum recompute",
+          full_duration.count() * 1e9 / static_cast<double>( iterations ),
+          "ns/op" );
+  report( "TTL decrement with incremental checksum update",
+          incremental_duration.count() * 1e9 / static_cast<double>( iterations ),
+          "ns/op" );
+}
+
+void forwarding_speed_test( const size_t num_datagrams, const size_t batch_size )
+{
+  Router router;
+  const size_t eth0 = router.add_interface( { router_eth0, Address { "10.0.0.1" } } );
+  const size_t eth1 = router.add_interface( { router_eth1, Address { "192.168.0.1" } } );
+  router.add_route( Address { "10.0.0.0" }.ipv4_numeric(), 8, {}, eth0 );
+  router.add_route( Address { "192.168.0.0" }.ipv4_numeric(), 24, {}, eth1 );
+  router.interface( eth1 ).recv_frame( make_arp_reply() );
+
+  const EthernetFrame frame = make_frame();
+  size_t forwarded = 0;
+
+  const auto start_time = steady_clock::now();
+  for ( size_t sent = 0; sent < num_datagrams; sent += batch_size ) {
+    for ( size_t i = 0; i < batch_size; ++i ) {
+      router.interface( eth0 ).recv_frame( frame );
+    }
+    router.route();
+    while ( router.interface( eth1 ).maybe_send().has_value() ) {
+      ++forwarded;
+    }
+  }
+  const auto test_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  if ( forwarded != num_datagrams ) {
+    throw runtime_error( "Router forwarded " + to_string( forwarded ) + " of " + to_string( num_datagrams )
+                         + " datagrams" );
+  }
+
+  const double packets_per_second = static_cast<double>( forwarded ) / test_duration.count();
+  report( "Router forwarding (batch=" + to_string( batch_size ) + ")", packets_per_second / 1e6, "Mpps" );
+
+  if ( packets_per_second < 10000 ) {
+    throw runtime_error( "Router did not meet minimum speed of 10k packets/s." );
+  }
+}
+
+// Random routes with a prefix-length mix loosely modeled on a BGP table: mostly /24s, a spread of
+// shorter prefixes, and a few longer ones.
+vector<RouterEntry> random_routes( const size_t num_routes, default_random_engine& rd )
+{
+  uniform_int_distribution<uint32_t> address_dist;
+  uniform_int_distribution<unsigned> shape_dist { 0, 99 };
+  uniform_int_distribution<unsigned> short_dist { 8, 23 };
+  uniform_int_distribution<unsigned> long_dist { 25, 32 };
+
+  vector<RouterEntry> routes;
+  routes.reserve( num_routes );
+  for ( size_t i = 0; i < num_routes; ++i ) {
+    const unsigned shape = shape_dist( rd );
+    const auto length = static_cast<uint8_t>( shape < 60 ? 24 : shape < 95 ? short_dist( rd ) : long_dist( rd ) );
+    const uint32_t mask = ~uint32_t { 0 } << ( 32 - length );
+    routes.push_back( { address_dist( rd ) & mask, length, {}, i % 8 } );
+  }
+  return routes;
+}
+
+// The straightforward scan over every route, used as the reference.
+optional<size_t> linear_lookup( const vector<RouterEntry>& routes, const uint32_t address )
+{
+  optional<size_t> match;
+  for ( size_t i = 0; i < routes.size(); ++i ) {
+    const uint8_t length = routes[i].prefix_length;
+    const uint32_t mask = length == 0 ? 0 : ~uint32_t { 0 } << ( 32 - length );
+    if ( ( address & mask ) == routes[i].route_prefix
+         and ( not match.has_value() or routes[*match].prefix_length < length ) ) {
+      match = i;
+    }
+  }
+  return match;
+}
+
+void lookup_speed_test( const size_t num_routes, const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  const vector<RouterEntry> routes = random_routes( num_routes, rd );
+
+  // Half the destinations fall inside some route's prefix, half are uniformly random.
+  vector<uint32_t> addresses( 1 << 20 );
+  uniform_int_distribution<uint32_t> address_dist;
+  uniform_int_distribution<size_t> route_dist { 0, num_routes - 1 };
+  for ( size_t i = 0; i < addresses.size(); ++i ) {
+    const auto& route = routes[route_dist( rd )];
+    const uint32_t host_mask = route.prefix_length == 32 ? 0 : ~uint32_t { 0 } >> route.prefix_length;
+    addresses[i] = i % 2 ? address_dist( rd ) : route.route_prefix | ( address_dist( rd ) & host_mask );
+  }
+
+  auto start_time = steady_clock::now();
+  const RouteTable table { routes };
+  const auto build_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  for ( size_t i = 0; i < 1000; ++i ) {
+    if ( table.lookup( addresses[i] ) != linear_lookup( routes, addresses[i] ) ) {
+      throw runtime_error( "RouteTable disagrees with a linear scan for "
+                           + Address::from_ipv4_numeric( addresses[i] ).ip() );
+    }
+  }
+
+  const size_t num_lookups = 16 * addresses.size();
+  size_t matched = 0;
+  start_time = steady_clock::now();
+  for ( size_t i = 0; i < num_lookups; ++i ) {
+    matched += table.lookup( addresses[i % addresses.size()] ).has_value();
+  }
+  const auto lookup_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  const size_t num_linear_lookups = max( size_t { 100 }, size_t { 20000000 } / num_routes );
+  start_time = steady_clock::now();
+  for ( size_t i = 0; i < num_linear_lookups; ++i ) {
+    matched += linear_lookup( routes, addresses[i] ).has_value();
+  }
+  const auto linear_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  if ( matched == 0 ) {
+    throw runtime_error( "no destination matched a route" );
+  }
+
+  report( "RouteTable build with " + to_string( num_routes ) + " routes", build_duration.count() * 1e3, "ms" );
+  report( "RouteTable lookups with " + to_string( num_routes ) + " routes",
+          static_cast<double>( num_lookups ) / lookup_duration.count() / 1e6,
+          "M lookups/s" );
+  report( "Linear scan lookups with " + to_string( num_routes ) + " routes",
+          static_cast<double>( num_linear_lookups ) / linear_duration.count() / 1e3,
+          "k lookups/s" );
+}
+
+// Forward traffic spread over `num_flows` destinations through a 10k-route table, with and without
+// the route cache.
+void route_cache_speed_test( const size_t num_flows, const size_t cache_size, const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  vector<RouterEntry> routes = random_routes( 10000, rd );
+
+  Router router { cache_size };
+  const size_t eth0 = router.add_interface( { router_eth0, Address { "10.0.0.1" } } );
+  const size_t eth1 = router.add_interface( { router_eth1, Address { "192.168.0.1" } } );
+  router.begin_batch();
+  for ( const auto& route : routes ) {
+    router.replace_route( route.route_prefix, route.prefix_length, Address { "192.168.0.2" }, eth1 );
+  }
+  router.replace_route( 0, 0, Address { "192.168.0.2" }, eth1 );
+  router.commit();
+  router.interface( eth1 ).recv_frame( make_arp_reply() );
+
+  uniform_int_distribution<uint32_t> address_dist;
+  vector<EthernetFrame> flows;
+  for ( size_t i = 0; i < num_flows; ++i ) {
+    flows.push_back( make_frame( address_dist( rd ) ) );
+  }
+  uniform_int_distribution<size_t> flow_dist { 0, num_flows - 1 };
+  vector<size_t> sequence( 1 << 16 );
+  for ( auto& flow : sequence ) {
+    flow = flow_dist( rd );
+  }
+
+  const size_t num_datagrams = 1000000;
+  const size_t batch_size = 64;
+  size_t forwarded = 0;
+
+  const auto start_time = steady_clock::now();
+  for ( size_t sent = 0; sent < num_datagrams; sent += batch_size ) {
+    for ( size_t i = 0; i < batch_size; ++i ) {
+      router.interface( eth0 ).recv_frame( flows[sequence[( sent + i ) % sequence.size()]] );
+    }
+    router.route();
+    while ( router.interface( eth1 ).maybe_send().has_value() ) {
+      ++forwarded;
+    }
+  }
+  const auto test_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  if ( forwarded != num_datagrams ) {
+    throw runtime_error( "Router forwarded " + to_string( forwarded ) + " of " + to_string( num_datagrams )
+                         + " datagrams" );
+  }
+
+  const string what = "Router with " + to_string( num_flows ) + " flows, "
+                      + ( cache_size ? to_string( cache_size ) + "-entry route cache" : "no route cache" );
+  if ( cache_size ) {
+    const auto lookups = static_cast<double>( router.route_cache_hits() + router.route_cache_misses() );
+    report( what + " hit rate", 100 * static_cast<double>( router.route_cache_hits() ) / lookups, "%" );
+  }
+  report( what, static_cast<double>( forwarded ) / test_duration.count() / 1e6, "Mpps" );
+}
+
+// Forward traffic between the ports of a many-port ShardedRouter: port i sends to the network behind
+// port i + 1. This thread plays every link.
+void sharded_forwarding_speed_test( const size_t num_ports, const size_t num_workers, const size_t num_datagrams )
+{
+  ShardedRouter router { num_workers };
+  const auto port_address = []( size_t port, uint8_t host ) {
+    return Address::from_ipv4_numeric( ( uint32_t { 10 } << 24 ) | ( static_cast<uint32_t>( port ) << 16 ) | host );
+  };
+  const auto router_eth = []( size_t port ) {
+    return EthernetAddress { 0x02, 0, 0, 1, 0, static_cast<uint8_t>( port ) };
+  };
+
+  vector<EthernetFrame> frames;
+  for ( size_t port = 0; port < num_ports; ++port ) {
+    router.add_interface( { router_eth( port ), port_address( port, 1 ) } );
+    router.add_route( port_address( port, 0 ).ipv4_numeric(), 16, port_address( port, 2 ), port );
+
+    // The next hop behind this port has already answered ARP.
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = host_eth;
+    arp.sender_ip_address = port_address( port, 2 ).ipv4_numeric();
+    arp.target_ethernet_address = router_eth( port );
+    arp.target_ip_address = port_address( port, 1 ).ipv4_numeric();
+    EthernetFrame arp_frame;
+    arp_frame.header.type = EthernetHeader::TYPE_ARP;
+    arp_frame.header.src = host_eth;
+    arp_frame.header.dst = router_eth( port );
+    arp_frame.payload = serialize( arp );
+    router.interface( port ).recv_frame( arp_frame );
+
+    EthernetFrame frame = make_frame( port_address( ( port + 1 ) % num_ports, 7 ).ipv4_numeric() );
+    frame.header.dst = router_eth( port );
+    frames.push_back( frame );
+  }
+
+  size_t sent = 0;
+  size_t forwarded = 0;
+  router.start();
+  const auto start_time = steady_clock::now();
+  while ( forwarded < num_datagrams ) {
+    for ( size_t port = 0; port < num_ports; ++port ) {
+      for ( unsigned i = 0; i < 32 and sent < num_datagrams; ++i ) {
+        EthernetFrame frame = frames[port];
+        if ( not router.deliver( port, std::move( frame ) ) ) {
+          break;
+        }
+        ++sent;
+      }
+      while ( router.collect( port ).has_value() ) {
+        ++forwarded;
+      }
+    }
+  }
+  const auto test_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+  router.stop();
+
+  report( "ShardedRouter with " + to_string( num_ports ) + " ports, " + to_string( num_workers ) + " workers",
+          static_cast<double>( forwarded ) / test_duration.count() / 1e6,
+          "Mpps" );
+}
+
+void program_body()
+{
+  ttl_speed_test( 1000000 );
+  forwarding_speed_test( 1000000, 64 );
+
+  for ( const size_t num_routes : { 1000, 10000, 100000 } ) {
+    lookup_speed_test( num_routes, 1372 + num_routes );
+  }
+
+  for ( const size_t num_flows : { 16, 4096 } ) {
+    route_cache_speed_test( num_flows, 0, 2813 );
+    route_cache_speed_test( num_flows, 1024, 2813 );
+  }
+
+  for ( const size_t num_workers : { 1, 2, 4 } ) {
+    sharded_forwarding_speed_test( 8, num_workers, 200000 );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,224 @@
+#include "arp_message.hh"
+#include "router.hh"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+static const EthernetAddress router_eth0 { 0x02, 0, 0, 0, 0, 0x01 };
+static const EthernetAddress router_eth1 { 0x02, 0, 0, 0, 0, 0x02 };
+static const EthernetAddress router_eth2 { 0x02, 0, 0, 0, 0, 0x03 };
+static const EthernetAddress host_eth { 0x02, 0, 0, 0, 0, 0x04 };
+
+uint32_t ip( const string& str )
+{
+  return Address { str }.ipv4_numeric();
+}
+
+// A router with one ingress interface and two possible egress interfaces whose next hops are already resolved.
+class UpdateNetwork
+{
+  Router router_ {};
+  size_t eth0_ { router_.add_interface( { router_eth0, Address { "10.0.0.1" } } ) };
+  size_t eth1_ { router_.add_interface( { router_eth1, Address { "192.168.0.1" } } ) };
+  size_t eth2_ { router_.add_interface( { router_eth2, Address { "172.16.0.1" } } ) };
+  EthernetFrame frame_ {};
+
+  static EthernetFrame arp_reply( const EthernetAddress& target_eth, const string& sender, const string& target )
+  {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = host_eth;
+    arp.sender_ip_address = ip( sender );
+    arp.target_ethernet_address = target_eth;
+    arp.target_ip_address = ip( target );
+
+    EthernetFrame frame;
+    frame.header.type = EthernetHeader::TYPE_ARP;
+    frame.header.src = host_eth;
+    frame.header.dst = target_eth;
+    frame.payload = serialize( arp );
+    return frame;
+  }
+
+  static size_t drain( AsyncNetworkInterface& interface )
+  {
+    size_t count = 0;
+    while ( interface.maybe_send().has_value() ) {
+      ++count;
+    }
+    return count;
+  }
+
+public:
+  UpdateNetwork()
+  {
+    router_.interface( eth1_ ).recv_frame( arp_reply( router_eth1, "192.168.0.2", "192.168.0.1" ) );
+    router_.interface( eth2_ ).recv_frame( arp_reply( router_eth2, "172.16.0.2", "172.16.0.1" ) );
+
+    InternetDatagram dgram;
+    dgram.header.src = ip( "10.0.0.2" );
+    dgram.header.dst = ip( "203.0.113.5" );
+    dgram.payload.emplace_back( string { "route update payload" } );
+    dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + dgram.payload.back().size();
+    dgram.header.compute_checksum();
+
+    frame_.header.type = EthernetHeader::TYPE_IPv4;
+    frame_.header.src = host_eth;
+    frame_.header.dst = router_eth0;
+    frame_.payload = serialize( dgram );
+  }
+
+  Router& router() { return router_; }
+  size_t eth1() const { return eth1_; }
+  size_t eth2() const { return eth2_; }
+
+  // Send one datagram to 203.0.113.5 through the router; returns the egress interface, if any.
+  optional<size_t> forward_one()
+  {
+    router_.interface( eth0_ ).recv_frame( frame_ );
+    router_.route();
+    const size_t out1 = drain( router_.interface( eth1_ ) );
+    const size_t out2 = drain( router_.interface( eth2_ ) );
+    if ( out1 + out2 > 1 ) {
+      throw runtime_error( "datagram was forwarded more than once" );
+    }
+    if ( out1 ) {
+      return eth1_;
+    }
+    if ( out2 ) {
+      return eth2_;
+    }
+    return {};
+  }
+
+  void expect( const string& what, optional<size_t> expected_interface )
+  {
+    const auto got = forward_one();
+    if ( got != expected_interface ) {
+      throw runtime_error( what + ": datagram went out on "
+                           + ( got.has_value() ? "interface " + to_string( *got ) : "no interface" ) );
+    }
+  }
+};
+
+void single_threaded_updates()
+{
+  UpdateNetwork network;
+  Router& router = network.router();
+
+  // Outside a batch, a change is published by the call that makes it, not by the forwarding path.
+  const uint64_t before_add = router.route_generation();
+  router.add_route( ip( "203.0.113.0" ), 24, Address { "192.168.0.2" }, network.eth1() );
+  if ( router.route_generation() != before_add + 1 ) {
+    throw runtime_error( "add_route outside a batch was not published by the call" );
+  }
+  network.expect( "after add_route", network.eth1() );
+
+  if ( not router.replace_route( ip( "203.0.113.0" ), 24, Address { "172.16.0.2" }, network.eth2() ) ) {
+    throw runtime_error( "replace_route did not find the existing route" );
+  }
+  network.expect( "after replace_route", network.eth2() );
+
+  if ( not router.remove_route( ip( "203.0.113.0" ), 24 ) ) {
+    throw runtime_error( "remove_route did not find the existing route" );
+  }
+  network.expect( "after remove_route", {} );
+  if ( router.remove_route( ip( "203.0.113.0" ), 24 ) ) {
+    throw runtime_error( "remove_route removed a route twice" );
+  }
+
+  const uint64_t generation = router.route_generation();
+  router.begin_batch();
+  router.add_route( ip( "203.0.0.0" ), 8, Address { "172.16.0.2" }, network.eth2() );
+  router.replace_route( ip( "203.0.113.0" ), 24, Address { "192.168.0.2" }, network.eth1() );
+  network.expect( "with a batch open", {} );
+  if ( router.route_generation() != generation ) {
+    throw runtime_error( "route() published changes from an open batch" );
+  }
+
+  if ( router.commit() != generation + 1 ) {
+    throw runtime_error( "commit() did not publish exactly one new generation" );
+  }
+  network.expect( "after commit", network.eth1() );
+
+  router.remove_route( ip( "203.0.113.0" ), 24 );
+  network.expect( "after removing the more specific route", network.eth2() );
+
+  // A route to an interface the router does not have is refused before it is staged, and the router carries on.
+  const uint64_t before_bad_route = router.route_generation();
+  for ( const bool replace : { false, true } ) {
+    bool refused = false;
+    try {
+      if ( replace ) {
+        router.replace_route( ip( "203.0.0.0" ), 8, {}, 99 );
+      } else {
+        router.add_route( ip( "198.51.100.0" ), 24, {}, 99 );
+      }
+    } catch ( const runtime_error& ) {
+      refused = true;
+    }
+    if ( not refused ) {
+      throw runtime_error( "a route to a nonexistent interface was accepted" );
+    }
+  }
+  network.expect( "after refusing the bad routes", network.eth2() );
+  if ( router.commit() != before_bad_route + 1 or router.remove_route( ip( "198.51.100.0" ), 24 ) ) {
+    throw runtime_error( "a refused route was staged" );
+  }
+  network.expect( "after committing", network.eth2() );
+}
+
+// A control thread keeps moving the route between the two egress interfaces (by withdrawing it and
+// adding it back in one batch) while this thread forwards. No datagram may ever see the route missing.
+void concurrent_updates()
+{
+  UpdateNetwork network;
+  Router& router = network.router();
+  router.add_route( ip( "203.0.113.0" ), 24, Address { "192.168.0.2" }, network.eth1() );
+
+  atomic<bool> done { false };
+  thread control { [&] {
+    bool use_eth2 = true;
+    for ( unsigned i = 0; i < 200; ++i ) {
+      router.begin_batch();
+      router.remove_route( ip( "203.0.113.0" ), 24 );
+      router.add_route( ip( "203.0.113.0" ),
+                        24,
+                        Address { use_eth2 ? "172.16.0.2" : "192.168.0.2" },
+                        use_eth2 ? network.eth2() : network.eth1() );
+      router.commit();
+      use_eth2 = not use_eth2;
+    }
+    done = true;
+  } };
+
+  size_t forwarded = 0;
+  while ( not done or forwarded < 1000 ) {
+    if ( not network.forward_one().has_value() ) {
+      control.join();
+      throw runtime_error( "datagram dropped during a concurrent route update" );
+    }
+    ++forwarded;
+  }
+  control.join();
+
+  if ( router.route_generation() != 201 ) {
+    throw runtime_error( "expected generation 201, found " + to_string( router.route_generation() ) );
+  }
+}
+
+int main()
+{
+  try {
+    single_threaded_updates();
+    concurrent_updates();
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
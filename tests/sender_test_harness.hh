@@ -54,6 +54,25 @@ struct ExpectSeqnosInFlight : public ExpectNumber<StreamAndSender, uint64_t>
   uint64_t value( StreamAndSender& ss ) const override { return ss.second.sequence_numbers_in_flight(); }
 };
 
+struct ExpectMsUntilDeadline : public Expectation<StreamAndSender>
+{
+  std::optional<uint64_t> ms_;
+  explicit ExpectMsUntilDeadline( std::optional<uint64_t> ms ) : ms_( ms ) {}
+  std::string description() const override
+  {
+    return ms_.has_value() ? "retransmission timer expires in " + std::to_string( ms_.value() ) + " ms"
+                           : "retransmission timer not running";
+  }
+  void execute( StreamAndSender& ss ) const override
+  {
+    const auto ms = ss.second.ms_until_deadline();
+    if ( ms != ms_ ) {
+      throw ExpectationViolation { "TCPSender::ms_until_deadline() returned "
+                                   + ( ms.has_value() ? std::to_string( ms.value() ) : "none" ) };
+    }
+  }
+};
+
 struct ExpectNoSegment : public Expectation<StreamAndSender>
 {
   std::string description() const override { return "nothing to send"; }
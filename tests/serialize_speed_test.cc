@@ -0,0 +1,130 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "header_view.hh"
+#include "ipv4_header.hh"
+#include "tcp_segment.hh"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr size_t ITERATIONS = 1000000;
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+string concat( const vector<Buffer>& buffers )
+{
+  string ret;
+  for ( const auto& buffer : buffers ) {
+    ret.append( buffer );
+  }
+  return ret;
+}
+
+// Serialize `obj` and parse it back ITERATIONS times each, reporting ns/op for both directions.
+template<class T, typename... Targs>
+void speed_test( const string& name, const T& obj, Targs... parse_args )
+{
+  const vector<Buffer> wire = serialize( obj );
+
+  size_t bytes = 0;
+  auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < ITERATIONS; ++i ) {
+    bytes += serialize( obj ).front().size();
+  }
+  const auto serialize_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  T parsed;
+  start_time = steady_clock::now();
+  for ( size_t i = 0; i < ITERATIONS; ++i ) {
+    if ( not parse( parsed, wire, parse_args... ) ) {
+      throw runtime_error( name + " failed to parse" );
+    }
+  }
+  const auto parse_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  if ( bytes != ITERATIONS * wire.front().size() or concat( serialize( parsed ) ) != concat( wire ) ) {
+    throw runtime_error( name + " did not survive a round trip" );
+  }
+
+  report( name + " serialize", serialize_duration.count() * 1e9 / ITERATIONS, "ns/op" );
+  report( name + " parse", parse_duration.count() * 1e9 / ITERATIONS, "ns/op" );
+}
+
+// Check a serialized header in place ITERATIONS times, reporting ns/op.
+template<class View>
+void view_speed_test( const string& name, const vector<Buffer>& wire )
+{
+  const string_view header = wire.front();
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < ITERATIONS; ++i ) {
+    if ( not View::parse( header ).has_value() ) {
+      throw runtime_error( name + " failed to parse" );
+    }
+  }
+  const auto parse_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  report( name + " parse", parse_duration.count() * 1e9 / ITERATIONS, "ns/op" );
+}
+
+void program_body()
+{
+  EthernetHeader ethernet_header;
+  ethernet_header.dst = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+  ethernet_header.src = { 0x02, 0x66, 0x77, 0x88, 0x99, 0xaa };
+  ethernet_header.type = EthernetHeader::TYPE_IPv4;
+  speed_test( "EthernetHeader", ethernet_header );
+
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = ethernet_header.src;
+  arp.sender_ip_address = 0x0a000001;
+  arp.target_ethernet_address = ethernet_header.dst;
+  arp.target_ip_address = 0x0a000002;
+  speed_test( "ARPMessage", arp );
+
+  IPv4Header ip_header;
+  ip_header.src = 0x0a000001;
+  ip_header.dst = 0x0a000002;
+  ip_header.len = IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH;
+  ip_header.compute_checksum();
+  speed_test( "IPv4Header", ip_header );
+  view_speed_test<IPv4HeaderView>( "IPv4HeaderView", serialize( ip_header ) );
+
+  TCPSegment seg;
+  seg.udinfo.src_port = 54321;
+  seg.udinfo.dst_port = 8080;
+  seg.sender_message.seqno = Wrap32 { 0x12345678 };
+  seg.receiver_message.ackno = Wrap32 { 0x9abcdef0 };
+  seg.receiver_message.window_size = 65535;
+  seg.compute_checksum( ip_header.pseudo_checksum() );
+  speed_test( "TCPSegment", seg, ip_header.pseudo_checksum() );
+  view_speed_test<TCPHeaderView>( "TCPHeaderView", serialize( seg ) );
+
+  seg.sender_message.payload = string( 1000, 'x' );
+  seg.compute_checksum( ip_header.pseudo_checksum() );
+  speed_test( "TCPSegment (1000-byte payload)", seg, ip_header.pseudo_checksum() );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
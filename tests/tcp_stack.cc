@@ -0,0 +1,182 @@
+#include "connection_table.hh"
+#include "exception.hh"
+#include "random.hh"
+#include "tcp_stack.hh"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static const Address server_address { "10.0.0.1", 80 };
+static constexpr size_t CONNECTIONS = 1000;
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+// Random inserts and erases, checked against std::map. Tuples share addresses and differ mostly in one port, as
+// a busy server's do, so that many collide in the table.
+void connection_table()
+{
+  auto rd = get_random_engine();
+  ConnectionTable<size_t> table;
+  map<uint32_t, size_t> reference; // by remote port
+  const auto tuple = []( const uint16_t port ) { return FourTuple { 1, 2, 80, port }; };
+
+  for ( size_t i = 0; i < 200000; ++i ) {
+    const uint16_t port = rd() % 5000;
+    if ( rd() % 3 ) {
+      const bool inserted = table.insert( tuple( port ), i );
+      expect( inserted == reference.try_emplace( port, i ).second, "insert disagreed with the reference" );
+    } else {
+      expect( table.erase( tuple( port ) ) == static_cast<bool>( reference.erase( port ) ),
+              "erase disagreed with the reference" );
+    }
+  }
+
+  expect( table.size() == reference.size(), "the table has the wrong size" );
+  for ( uint16_t port = 0; port < 5000; ++port ) {
+    const size_t* value = table.find( tuple( port ) );
+    const auto it = reference.find( port );
+    expect( ( value == nullptr ) == ( it == reference.end() ) and ( not value or *value == it->second ),
+            "find disagreed with the reference" );
+  }
+  expect( not table.find( { 1, 2, 81, 0 } ) and not table.find( { 2, 1, 80, 0 } ),
+          "found a tuple that differs in another field" );
+}
+
+pair<FileDescriptor, FileDescriptor> datagram_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+TCPConfig small_config( const uint16_t rt_timeout = TCPConfig::TIMEOUT_DFLT )
+{
+  TCPConfig config;
+  config.rt_timeout = rt_timeout;
+  config.send_capacity = 1000;
+  config.recv_capacity = 1000;
+  return config;
+}
+
+// Run the loop until `done`, failing after a few seconds
+void run_until( EventLoop& loop, const function<bool()>& done, const string& what )
+{
+  const auto give_up = steady_clock::now() + 5s;
+  while ( not done() ) {
+    expect( steady_clock::now() < give_up, "timed out waiting for " + what );
+    loop.wait_next_event( 100 );
+  }
+}
+
+// A server stack echoes on many connections from a client stack, over a datagram socketpair, on one loop.
+void many_connections( const EventLoop::Backend backend, const string& name )
+{
+  auto [server_device, client_device] = datagram_pair();
+  EventLoop loop { backend };
+  TCPStack server { move( server_device ), loop };
+  TCPStack client { move( client_device ), loop };
+
+  vector<shared_ptr<TCPStack::Connection>> accepted;
+  server.listen( small_config(), Address { "0", server_address.port() }, [&]( const auto& connection ) {
+    accepted.push_back( connection );
+    TCPStack::Connection& echo = *connection;
+    echo.set_receive_callback( [&echo] {
+      Reader& inbound = echo.inbound_reader();
+      while ( inbound.bytes_buffered() ) {
+        const string data { inbound.peek() };
+        echo.outbound_writer().push( data );
+        inbound.pop( data.size() );
+      }
+      if ( inbound.is_finished() and not echo.outbound_writer().is_closed() ) {
+        echo.outbound_writer().close();
+      }
+    } );
+  } );
+
+  bool threw = false;
+  try {
+    server.listen( small_config(), server_address, {} );
+  } catch ( const runtime_error& ) {
+    threw = true;
+  }
+  expect( threw, name + ": listening twice on a port should throw" );
+
+  vector<shared_ptr<TCPStack::Connection>> connections;
+  vector<string> echoed( CONNECTIONS );
+  for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+    auto connection = client.connect(
+      small_config(), Address { "10.0.0.2", static_cast<uint16_t>( 10000 + i ) }, server_address );
+    connection->outbound_writer().push( "message " + to_string( i ) );
+    connection->outbound_writer().close();
+    client.push( connection );
+
+    TCPStack::Connection& ours = *connection;
+    connection->set_receive_callback( [&ours, &received = echoed[i]] {
+      received += ours.inbound_reader().peek();
+      ours.inbound_reader().pop( ours.inbound_reader().peek().size() );
+    } );
+    connections.push_back( move( connection ) );
+  }
+  expect( client.connection_count() == CONNECTIONS, name + ": the client should have every connection open" );
+
+  run_until(
+    loop,
+    [&] { return client.connection_count() == 0 and server.connection_count() == 0; },
+    "the connections to close" );
+
+  expect( accepted.size() == CONNECTIONS, name + ": the server should have accepted every connection" );
+  for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+    expect( echoed[i] == "message " + to_string( i ), name + ": connection " + to_string( i ) + " got \""
+                                                        + echoed[i] + "\" back" );
+    expect( connections[i]->established() and not connections[i]->open()
+              and connections[i]->inbound_reader().is_finished(),
+            name + ": connection " + to_string( i ) + " should have finished cleanly" );
+  }
+  expect( server.dropped() == 0 and client.dropped() == 0, name + ": no datagrams should have been dropped" );
+}
+
+// A SYN to a port that is not listening is dropped; the client's timer retransmits it until the port listens.
+void retransmitted_syn( const EventLoop::Backend backend, const string& name )
+{
+  auto [server_device, client_device] = datagram_pair();
+  EventLoop loop { backend };
+  TCPStack server { move( server_device ), loop };
+  TCPStack client { move( client_device ), loop };
+
+  const auto connection = client.connect( small_config( 20 ), Address { "10.0.0.2", 10000 }, server_address );
+  run_until( loop, [&] { return server.dropped() == 1; }, "the first SYN to be dropped" );
+
+  size_t accepted = 0;
+  server.listen( small_config( 20 ), server_address, [&]( const auto& ) { ++accepted; } );
+  run_until( loop, [&] { return connection->established() and accepted == 1; }, "the retransmitted SYN" );
+  expect( connection->peer().sender().consecutive_retransmissions() == 0,
+          name + ": the handshake should have reset the retransmissions" );
+}
+
+int main()
+{
+  try {
+    connection_table();
+    for ( const auto& [backend, name] :
+          { pair { EventLoop::Backend::Poll, "poll" }, pair { EventLoop::Backend::Epoll, "epoll" } } ) {
+      many_connections( backend, name );
+      retransmitted_syn( backend, name );
+    }
+  } catch ( const exception& e ) {
+    cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+#include "exception.hh"
+#include "tcp_stack.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr size_t ROUNDS = 10;
+static const string MESSAGE( 100, 'x' );
+
+void report( const string& what, const double rate, const string& unit )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << rate << " " << unit << ".\n";
+  debug_output << "             " << what << ": " << fixed << setprecision( 2 ) << rate << " " << unit << "\n";
+}
+
+// Run the loop until `done`
+void run_until( EventLoop& loop, const function<bool()>& done )
+{
+  while ( not done() ) {
+    loop.wait_next_event( 1000 );
+  }
+}
+
+// Open `count` connections between two stacks on one loop, then have every client send a message that the server
+// echoes, ROUNDS times. If demultiplexing is O(1), the time per echo does not grow with the number of connections.
+void stack_speed_test( const size_t count )
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+  EventLoop loop { EventLoop::Backend::Epoll };
+  TCPStack server { FileDescriptor { fds[0] }, loop };
+  TCPStack client { FileDescriptor { fds[1] }, loop };
+
+  TCPConfig config;
+  config.send_capacity = 1000;
+  config.recv_capacity = 1000;
+
+  size_t accepted = 0;
+  server.listen( config, Address { "10.0.0.1", 80 }, [&]( const auto& connection ) {
+    ++accepted;
+    TCPStack::Connection& echo = *connection;
+    echo.set_receive_callback( [&echo] {
+      Reader& inbound = echo.inbound_reader();
+      while ( inbound.bytes_buffered() ) {
+        const string data { inbound.peek() };
+        echo.outbound_writer().push( data );
+        inbound.pop( data.size() );
+      }
+    } );
+  } );
+
+  vector<shared_ptr<TCPStack::Connection>> connections;
+  size_t echoed = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < count; ++i ) {
+    connections.push_back( client.connect(
+      config, Address { "10.0.0." + to_string( 2 + i / 50000 ), static_cast<uint16_t>( 10000 + i % 50000 ) },
+      Address { "10.0.0.1", 80 } ) );
+    TCPStack::Connection& ours = *connections.back();
+    ours.set_receive_callback( [&ours, &echoed] {
+      echoed += ours.inbound_reader().bytes_buffered();
+      ours.inbound_reader().pop( ours.inbound_reader().bytes_buffered() );
+    } );
+  }
+  run_until( loop, [&] { return accepted == count; } );
+  const duration<double> handshakes = steady_clock::now() - start_time;
+
+  const auto echo_start_time = steady_clock::now();
+  for ( size_t round = 1; round <= ROUNDS; ++round ) {
+    for ( const auto& connection : connections ) {
+      connection->outbound_writer().push( MESSAGE );
+      client.push( connection );
+    }
+    run_until( loop, [&] { return echoed == round * count * MESSAGE.size(); } );
+  }
+  const duration<double> echoes = steady_clock::now() - echo_start_time;
+
+  if ( server.dropped() or client.dropped() or server.connection_count() != count ) {
+    throw runtime_error( "datagrams were dropped, or connections lost" );
+  }
+
+  const string what = to_string( count ) + " connections";
+  report( what + ", handshakes", static_cast<double>( count ) / handshakes.count(), "connections/s" );
+  report( what + ", echoes", echoes.count() * 1e6 / static_cast<double>( count * ROUNDS ), "us/echo" );
+}
+
+void program_body()
+{
+  for ( const size_t count : { 100, 10000 } ) {
+    stack_speed_test( count );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
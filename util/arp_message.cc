@@ -62,6 +62,8 @@ void ARPMessage::serialize( Serializer& serializer ) const
     throw runtime_error( "ARPMessage: unsupported field combination (must be Ethernet/IP, and request or reply)" );
   }
 
+  serializer.reserve( LENGTH );
+
   serializer.integer( hardware_type );
   serializer.integer( protocol_type );
   serializer.integer( hardware_address_size );
@@ -2,22 +2,94 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
+// A refcounted string, or a slice [offset, offset + length) of one. Copying and slicing share the storage.
 class Buffer
 {
   std::shared_ptr<std::string> buffer_;
+  size_t offset_ {};
+  size_t length_ { std::string::npos }; // npos: all of the string, whatever its current size
+
+  bool sliced() const { return length_ != std::string::npos; }
+
+  // Give a slice (or an empty Buffer) its own string, so that the whole string can be handed out
+  void unslice()
+  {
+    if ( sliced() or not buffer_ ) {
+      buffer_ = std::make_shared<std::string>( std::string_view { *this } );
+      offset_ = 0;
+      length_ = std::string::npos;
+    }
+  }
 
 public:
+  // An empty Buffer, which allocates nothing until it is modified
+  Buffer() : buffer_() {}
+
   // NOLINTBEGIN(*-explicit-*)
 
-  Buffer( std::string str = {} ) : buffer_( make_shared<std::string>( std::move( str ) ) ) {}
-  operator std::string_view() const { return *buffer_; }
-  operator std::string&() { return *buffer_; }
+  Buffer( std::string str ) : buffer_( make_shared<std::string>( std::move( str ) ) ) {}
+  operator std::string_view() const
+  {
+    if ( not buffer_ ) {
+      return {};
+    }
+    const std::string_view whole { *buffer_ };
+    return sliced() ? whole.substr( offset_, length_ ) : whole;
+  }
+  operator std::string&()
+  {
+    unslice();
+    return *buffer_;
+  }
 
   // NOLINTEND(*-explicit-*)
 
-  std::string&& release() { return std::move( *buffer_ ); }
-  size_t size() const { return buffer_->size(); }
-  size_t length() const { return buffer_->length(); }
-  bool empty() const { return buffer_->empty(); }
+  // A Buffer over existing storage (e.g. from a BufferPool)
+  explicit Buffer( std::shared_ptr<std::string> storage ) : buffer_( std::move( storage ) ) {}
+
+  // Bytes [pos, pos + n) of this Buffer, sharing its storage (throws std::out_of_range if pos > size())
+  Buffer substr( size_t pos, size_t n = std::string::npos ) const
+  {
+    Buffer ret = *this;
+    ret.length_ = std::string_view { *this }.substr( pos, n ).size();
+    ret.offset_ += pos;
+    return ret;
+  }
+
+  // The bytes as a string of their own: moved out if nothing else refers to the storage, copied otherwise
+  std::string take() &&
+  {
+    if ( buffer_ and not sliced() and buffer_.use_count() == 1 ) {
+      return std::move( *buffer_ );
+    }
+    return std::string { std::string_view { *this } };
+  }
+
+  // Slices shorter than this are copied by compact() rather than shared
+  static constexpr size_t MIN_SHARED_SLICE = 512;
+
+  // The same bytes, without keeping a much larger string alive: an empty Buffer allocates nothing, and a slice
+  // shorter than MIN_SHARED_SLICE (e.g. a small payload in a pooled 16 KiB packet buffer) gets a string of its
+  // own, so that the larger string can be recycled. Anything else is returned as is.
+  Buffer compact() &&
+  {
+    if ( empty() ) {
+      return {};
+    }
+    if ( sliced() and size() < MIN_SHARED_SLICE ) {
+      return Buffer { std::string { std::string_view { *this } } };
+    }
+    return std::move( *this );
+  }
+
+  std::string&& release()
+  {
+    unslice();
+    return std::move( *buffer_ );
+  }
+  size_t size() const { return sliced() ? length_ : buffer_ ? buffer_->size() : 0; }
+  size_t length() const { return size(); }
+  bool empty() const { return size() == 0; }
 };
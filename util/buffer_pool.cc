@@ -0,0 +1,38 @@
+#include "buffer_pool.hh"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+shared_ptr<string> BufferPool::acquire()
+{
+  for ( size_t i = 0; i < min( SCAN_LIMIT, slots_.size() ); ++i ) {
+    const shared_ptr<string>& slot = slots_[next_];
+    next_ = ( next_ + 1 ) % slots_.size();
+    if ( slot.use_count() == 1 ) {
+      // The last other reference may have been dropped on another thread; see its writes before reusing.
+      atomic_thread_fence( memory_order_acquire );
+      return slot;
+    }
+  }
+
+  ++allocations_;
+  auto fresh = make_shared<string>();
+  if ( slots_.size() < max_slots_ ) {
+    slots_.push_back( fresh );
+  }
+  return fresh;
+}
+
+BufferPool& BufferPool::packets()
+{
+  thread_local BufferPool pool { 256 };
+  return pool;
+}
+
+BufferPool& BufferPool::headers()
+{
+  thread_local BufferPool pool { 4096 };
+  return pool;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A pool of reusable strings for packet buffers.
+//
+// The pool keeps a reference to every string it hands out, and hands the string out again once that is the
+// only reference left, i.e. once every Buffer made from it has been dropped. Strings keep their capacity from
+// one use to the next, so a pool in steady state reads and serializes packets without calling the allocator.
+// Each pool belongs to one thread (see packets() and headers()), but the Buffers made from its strings may be
+// passed to, and dropped on, any thread.
+class BufferPool
+{
+  std::vector<std::shared_ptr<std::string>> slots_ {};
+  size_t next_ {};
+  size_t max_slots_;
+  uint64_t allocations_ {};
+
+public:
+  // How many slots acquire() looks at before giving up and allocating
+  static constexpr size_t SCAN_LIMIT = 8;
+
+  explicit BufferPool( size_t max_slots ) : max_slots_( max_slots ) {}
+
+  // A string that nothing else refers to. Its contents are unspecified.
+  std::shared_ptr<std::string> acquire();
+
+  uint64_t allocations() const { return allocations_; } // strings allocated because none was free
+  size_t size() const { return slots_.size(); }         // strings held for reuse
+
+  // This thread's pool of buffers to read packets into
+  static BufferPool& packets();
+
+  // This thread's pool of buffers for serialized headers
+  static BufferPool& headers();
+};
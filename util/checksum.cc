@@ -0,0 +1,146 @@
+#include "checksum.hh"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Fold a 64-bit one's complement sum down to 16 bits.
+uint16_t fold( uint64_t sum )
+{
+  sum = ( sum >> 32 ) + ( sum & 0xffffffff );
+  sum = ( sum >> 32 ) + ( sum & 0xffffffff );
+  sum = ( sum >> 16 ) + ( sum & 0xffff );
+  sum = ( sum >> 16 ) + ( sum & 0xffff );
+  return static_cast<uint16_t>( sum );
+}
+
+// Add `a` and `b` with end-around carry.
+uint64_t add_carry( uint64_t a, uint64_t b )
+{
+  const uint64_t sum = a + b;
+  return sum + ( sum < b );
+}
+
+// Each kernel sums an even number of bytes as host-order 16-bit words and returns the sum folded to 16 bits.
+// The one's complement sum does not depend on byte order (RFC 1071), so the caller only swaps the result.
+
+uint16_t sum_scalar( const char* data, size_t len )
+{
+  uint64_t sum = 0;
+  for ( ; len >= 8; data += 8, len -= 8 ) {
+    uint64_t word {};
+    memcpy( &word, data, 8 );
+    sum = add_carry( sum, word );
+  }
+
+  uint64_t tail {};
+  memcpy( &tail, data, len );
+  return fold( add_carry( sum, tail ) );
+}
+
+#if defined( __x86_64__ )
+
+// Each iteration adds two 16-bit words (one unpacked low, one high) to every 32-bit lane, so a lane gains at most
+// 2 * 0xffff per iteration; 32768 iterations (2^32 / 0x1fffe, rounded down) is the most that cannot overflow.
+constexpr size_t SIMD_BLOCK_ITERATIONS = 32768;
+
+uint16_t sum_sse2( const char* data, size_t len )
+{
+  uint64_t sum = 0;
+  const __m128i zero = _mm_setzero_si128();
+
+  while ( len >= 16 ) {
+    __m128i acc = _mm_setzero_si128();
+    for ( size_t i = 0; i < SIMD_BLOCK_ITERATIONS and len >= 16; ++i, data += 16, len -= 16 ) {
+      const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) ); // NOLINT(*-reinterpret-cast)
+      acc = _mm_add_epi32( acc, _mm_unpacklo_epi16( v, zero ) );
+      acc = _mm_add_epi32( acc, _mm_unpackhi_epi16( v, zero ) );
+    }
+
+    alignas( 16 ) array<uint32_t, 4> lanes {};
+    _mm_store_si128( reinterpret_cast<__m128i*>( lanes.data() ), acc ); // NOLINT(*-reinterpret-cast)
+    for ( const uint32_t lane : lanes ) {
+      sum += lane;
+    }
+  }
+
+  return fold( add_carry( sum, sum_scalar( data, len ) ) );
+}
+
+__attribute__( ( target( "avx2" ) ) ) uint16_t sum_avx2( const char* data, size_t len )
+{
+  uint64_t sum = 0;
+  const __m256i zero = _mm256_setzero_si256();
+
+  while ( len >= 32 ) {
+    __m256i acc = _mm256_setzero_si256();
+    for ( size_t i = 0; i < SIMD_BLOCK_ITERATIONS and len >= 32; ++i, data += 32, len -= 32 ) {
+      const auto* const block = reinterpret_cast<const __m256i*>( data ); // NOLINT(*-reinterpret-cast)
+      const __m256i v = _mm256_loadu_si256( block );
+      acc = _mm256_add_epi32( acc, _mm256_unpacklo_epi16( v, zero ) );
+      acc = _mm256_add_epi32( acc, _mm256_unpackhi_epi16( v, zero ) );
+    }
+
+    alignas( 32 ) array<uint32_t, 8> lanes {};
+    _mm256_store_si256( reinterpret_cast<__m256i*>( lanes.data() ), acc ); // NOLINT(*-reinterpret-cast)
+    for ( const uint32_t lane : lanes ) {
+      sum += lane;
+    }
+  }
+
+  return fold( add_carry( sum, sum_scalar( data, len ) ) );
+}
+
+#endif
+
+using Kernel = uint16_t ( * )( const char*, size_t );
+
+Kernel pick_kernel()
+{
+#if defined( __x86_64__ )
+  if ( __builtin_cpu_supports( "avx2" ) ) {
+    return sum_avx2;
+  }
+  return sum_sse2; // SSE2 is part of the x86-64 baseline
+#else
+  return sum_scalar;
+#endif
+}
+
+const Kernel sum_words = pick_kernel();
+
+} // namespace
+
+void InternetChecksum::add( string_view data )
+{
+  if ( data.empty() ) {
+    return;
+  }
+
+  // Finish the 16-bit word left open by a previous odd-length add: this byte is its low half.
+  if ( parity_ ) {
+    sum_ += static_cast<uint8_t>( data.front() );
+    data.remove_prefix( 1 );
+    parity_ = false;
+  }
+
+  uint16_t words = sum_words( data.data(), data.size() & ~size_t { 1 } );
+  if constexpr ( endian::native == endian::little ) {
+    words = static_cast<uint16_t>( ( words << 8 ) | ( words >> 8 ) );
+  }
+  sum_ += words;
+
+  // An odd trailing byte is the high half of a word completed by the next add.
+  if ( data.size() % 2 ) {
+    sum_ += static_cast<uint16_t>( static_cast<uint8_t>( data.back() ) << 8 );
+    parity_ = true;
+  }
+}
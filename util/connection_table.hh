@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// The addresses and ports of a TCP connection, as seen from this end
+struct FourTuple
+{
+  uint32_t local_address;
+  uint32_t remote_address;
+  uint16_t local_port;
+  uint16_t remote_port;
+
+  bool operator==( const FourTuple& other ) const = default;
+};
+
+// A hash table from FourTuple to Value, kept in one flat array of slots (open addressing).
+//
+// A lookup hashes the tuple to a slot and probes the following slots until it finds the tuple or an empty
+// slot. The table is kept at most half full, so a probe usually ends within a slot or two of where it started,
+// and finding a connection costs one hash and about one cache miss however many connections there are.
+// Erasing shifts the rest of the probe run back over the hole instead of leaving a tombstone, so lookups stay
+// short as connections come and go.
+template<typename Value>
+class ConnectionTable
+{
+  struct Slot
+  {
+    FourTuple key {};
+    Value value {};
+    bool used {};
+  };
+
+  static constexpr size_t INITIAL_SLOTS = 16; // a power of two, as every size of the table is
+
+  std::vector<Slot> slots_ = std::vector<Slot>( INITIAL_SLOTS );
+  size_t size_ {};
+
+  size_t mask() const { return slots_.size() - 1; }
+
+  // Where the probe for `key` starts
+  size_t home( const FourTuple& key ) const
+  {
+    // Mix both addresses and both ports into 64 bits, then finish as MurmurHash3 does, so that tuples that
+    // differ only in a port spread across the whole table.
+    uint64_t h = ( static_cast<uint64_t>( key.local_address ) << 32 | key.remote_address )
+                 ^ ( ( static_cast<uint64_t>( key.local_port ) << 16 | key.remote_port ) * 0x9e3779b97f4a7c15 );
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53;
+    h ^= h >> 33;
+    return h & mask();
+  }
+
+  // The slot holding `key`, or the empty slot where it would go
+  size_t probe( const FourTuple& key ) const
+  {
+    size_t i = home( key );
+    while ( slots_[i].used and not( slots_[i].key == key ) ) {
+      i = ( i + 1 ) & mask();
+    }
+    return i;
+  }
+
+  // Double the number of slots, and re-insert every entry
+  void grow()
+  {
+    std::vector<Slot> old = std::exchange( slots_, std::vector<Slot>( slots_.size() * 2 ) );
+    for ( auto& slot : old ) {
+      if ( slot.used ) {
+        slots_[probe( slot.key )] = std::move( slot );
+      }
+    }
+  }
+
+public:
+  // The value for `key`, or nullptr if there is none (valid until the table is next modified)
+  Value* find( const FourTuple& key )
+  {
+    Slot& slot = slots_[probe( key )];
+    return slot.used ? &slot.value : nullptr;
+  }
+
+  // Add `key` with `value`; returns false (and changes nothing) if `key` is already there
+  bool insert( const FourTuple& key, Value value )
+  {
+    if ( ( size_ + 1 ) * 2 > slots_.size() ) {
+      grow();
+    }
+    Slot& slot = slots_[probe( key )];
+    if ( slot.used ) {
+      return false;
+    }
+    slot = { key, std::move( value ), true };
+    ++size_;
+    return true;
+  }
+
+  // Remove `key`; returns false if it was not there
+  bool erase( const FourTuple& key )
+  {
+    size_t hole = probe( key );
+    if ( not slots_[hole].used ) {
+      return false;
+    }
+
+    // Move back each later entry of the run whose probe would pass the hole on its way to it.
+    for ( size_t i = ( hole + 1 ) & mask(); slots_[i].used; i = ( i + 1 ) & mask() ) {
+      if ( ( ( i - home( slots_[i].key ) ) & mask() ) >= ( ( i - hole ) & mask() ) ) {
+        slots_[hole] = std::move( slots_[i] );
+        hole = i;
+      }
+    }
+    slots_[hole] = {};
+    --size_;
+    return true;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+};
@@ -59,6 +59,8 @@ void EthernetHeader::parse( Parser& parser )
 
 void EthernetHeader::serialize( Serializer& serializer ) const
 {
+  serializer.reserve( LENGTH );
+
   // write destination address
   for ( const auto& b : dst ) {
     serializer.integer( b );
@@ -2,9 +2,13 @@
 #include "exception.hh"
 #include "socket.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <span>
+#include <sys/epoll.h>
 
 using namespace std;
 
@@ -13,16 +17,53 @@ unsigned int EventLoop::FDRule::service_count() const
   return direction == Direction::In ? fd.read_count() : fd.write_count();
 }
 
-size_t EventLoop::add_category( const string& name )
+bool EventLoop::FDRule::defunct() const
+{
+  return fd.closed() or ( direction == Direction::In and fd.eof() );
+}
+
+EventLoop::EventLoop( const Backend backend ) : _backend( backend )
+{
+  _rule_categories.reserve( 64 );
+  if ( _backend == Backend::Epoll ) {
+    _epoll.emplace( CheckSystemCall( "epoll_create1", ::epoll_create1( EPOLL_CLOEXEC ) ) );
+  } else if ( _backend == Backend::IOUring ) {
+    if ( IOUring::supported() ) {
+      _uring.emplace( 256 );
+    } else {
+      _backend = Backend::Poll;
+    }
+  }
+}
+
+size_t EventLoop::add_category( const string& name, const Budget& budget )
 {
   if ( _rule_categories.size() >= _rule_categories.capacity() ) {
     throw runtime_error( "maximum categories reached" );
   }
+  if ( budget.iterations == 0 or budget.bytes == 0 ) {
+    throw invalid_argument( "EventLoop: category \"" + name + "\" has an empty budget" );
+  }
 
-  _rule_categories.push_back( { name } );
+  _rule_categories.push_back( { name, budget } );
   return _rule_categories.size() - 1;
 }
 
+const EventLoop::CategoryStats& EventLoop::stats( const size_t category_id ) const
+{
+  return _rule_categories.at( category_id ).stats;
+}
+
+void EventLoop::print_stats( ostream& out ) const
+{
+  for ( const auto& [name, budget, stats] : _rule_categories ) {
+    out << "\"" << name << "\": " << stats.calls << " calls, " << stats.bytes << " bytes, "
+        << chrono::duration_cast<chrono::microseconds>( stats.time ).count() << " us, deferred " << stats.deferred
+        << " times, waited at most " << chrono::duration_cast<chrono::microseconds>( stats.max_delay ).count()
+        << " us\n";
+  }
+}
+
 EventLoop::BasicRule::BasicRule( size_t s_category_id, InterestT s_interest, CallbackT s_callback )
   : category_id( s_category_id ), interest( move( s_interest ) ), callback( move( s_callback ) )
 {}
@@ -51,10 +92,85 @@ EventLoop::RuleHandle EventLoop::add_rule( size_t category_id,
     throw out_of_range( "bad category_id" );
   }
 
-  _fd_rules.emplace_back( make_shared<FDRule>(
-    BasicRule { category_id, interest, callback }, fd.duplicate(), direction, cancel, recover ) );
+  auto rule = make_shared<FDRule>(
+    BasicRule { category_id, interest, callback }, fd.duplicate(), direction, cancel, recover );
+
+  if ( _backend == Backend::Poll ) {
+    _fd_rules.push_back( rule );
+    return RuleHandle { rule };
+  }
+
+  // If this fd number was closed and reused, the old rules on it are defunct.
+  if ( auto old = _registrations.find( rule->fd.fd_num() ); old != _registrations.end() ) {
+    for ( const auto& old_rule : vector { old->second.rules } ) {
+      if ( old_rule->fd.closed() ) {
+        remove_rule( old_rule, true );
+      }
+    }
+  }
 
-  return RuleHandle { _fd_rules.back() };
+  // A rule with an interest function is armed when wait_next_event first asks it.
+  rule->loop_cancellations = _cancellations;
+  rule->armed = not rule->interest;
+  if ( rule->interest ) {
+    _conditional_rules.push_back( rule );
+  }
+  auto& registration = _registrations[rule->fd.fd_num()];
+  registration.rules.push_back( rule );
+  update_registration( rule->fd.fd_num(), registration );
+
+  return RuleHandle { rule };
+}
+
+EventLoop::TimerRule::TimerRule( BasicRule&& base, const chrono::steady_clock::time_point s_deadline )
+  : BasicRule( base ), deadline( s_deadline )
+{}
+
+static uint64_t steady_ns( const chrono::steady_clock::time_point time )
+{
+  return chrono::duration_cast<chrono::nanoseconds>( time.time_since_epoch() ).count();
+}
+
+EventLoop::RuleHandle EventLoop::add_timer( const size_t category_id,
+                                            const chrono::steady_clock::time_point deadline,
+                                            const CallbackT& callback )
+{
+  if ( category_id >= _rule_categories.size() ) {
+    throw out_of_range( "bad category_id" );
+  }
+
+  auto timer = make_shared<TimerRule>( BasicRule { category_id, {}, callback }, deadline );
+  _timers.schedule( timer, steady_ns( deadline ) );
+  return RuleHandle { timer };
+}
+
+bool EventLoop::run_timers()
+{
+  bool timer_fired = false;
+  _timers.expire( steady_ns( chrono::steady_clock::now() ), [&]( const shared_ptr<TimerRule>& timer, uint64_t ) {
+    if ( not timer->cancel_requested ) {
+      timer_fired = true;
+      run_callback( *timer );
+    }
+  } );
+  return timer_fired;
+}
+
+int EventLoop::ms_until_next_timer()
+{
+  _timers.drop_while( []( const shared_ptr<TimerRule>& timer ) { return timer->cancel_requested; } );
+  const auto deadline = _timers.next_deadline();
+  if ( not deadline ) {
+    return -1;
+  }
+
+  const uint64_t now = steady_ns( chrono::steady_clock::now() );
+  if ( *deadline <= now ) {
+    return 0;
+  }
+  // Round up, so as not to wake up just before the deadline
+  const uint64_t ms = ( *deadline - now + 999'999 ) / 1'000'000;
+  return static_cast<int>( min( ms, static_cast<uint64_t>( numeric_limits<int>::max() ) ) );
 }
 
 EventLoop::RuleHandle EventLoop::add_rule( const size_t category_id,
@@ -75,6 +191,87 @@ void EventLoop::RuleHandle::cancel()
   const shared_ptr<BasicRule> rule_shared_ptr = rule_weak_ptr_.lock();
   if ( rule_shared_ptr ) {
     rule_shared_ptr->cancel_requested = true;
+    if ( rule_shared_ptr->loop_cancellations ) {
+      *rule_shared_ptr->loop_cancellations = true;
+    }
+  }
+}
+
+void EventLoop::report_error( const FDRule& rule ) const
+{
+  /* see if fd is a socket */
+  int socket_error = 0;
+  socklen_t optlen = sizeof( socket_error );
+  const int ret = getsockopt( rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
+  if ( ret == -1 and errno == ENOTSOCK ) {
+    cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( rule.category_id ).name << "\"\n";
+  } else if ( ret == -1 ) {
+    throw unix_error( "getsockopt" );
+  } else if ( optlen != sizeof( socket_error ) ) {
+    throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
+  } else if ( socket_error ) {
+    cerr << "error on polled socket for rule \"" << _rule_categories.at( rule.category_id ).name
+         << "\": " << strerror( socket_error ) << "\n";
+  }
+}
+
+void EventLoop::run_callback( BasicRule& rule )
+{
+  auto& stats = _rule_categories.at( rule.category_id ).stats;
+  const auto start_time = chrono::steady_clock::now();
+  rule.callback();
+  stats.time += chrono::steady_clock::now() - start_time;
+  ++stats.calls;
+}
+
+void EventLoop::serve( vector<shared_ptr<FDRule>>& ready )
+{
+  const auto ready_time = chrono::steady_clock::now();
+
+  // Round-robin: on each wakeup, a different category's rules go first.
+  const size_t categories = _rule_categories.size();
+  ranges::stable_sort( ready, {}, [&]( const auto& rule ) {
+    return ( rule->category_id + categories - _first_category ) % categories;
+  } );
+  _first_category = ( _first_category + 1 ) % categories;
+
+  for ( const auto& rule : ready ) {
+    // An earlier callback may have cancelled the rule, closed its fd, or taken away its interest.
+    if ( rule->cancel_requested or rule->defunct() or not rule->interested() ) {
+      continue;
+    }
+
+    auto& [name, budget, stats] = _rule_categories.at( rule->category_id );
+    stats.max_delay = max( stats.max_delay, chrono::steady_clock::now() - ready_time );
+
+    const auto transferred = [&] {
+      return rule->direction == Direction::In ? rule->fd.bytes_read() : rule->fd.bytes_written();
+    };
+    const uint64_t bytes_before = transferred();
+
+    auto count_before = rule->service_count();
+    run_callback( *rule );
+    if ( count_before == rule->service_count() and ( not rule->fd.closed() ) and rule->interested() ) {
+      throw runtime_error( "EventLoop: busy wait detected: rule \"" + name
+                           + "\" did not read/write fd and is still interested" );
+    }
+
+    // Reading again cannot block a non-blocking fd, so a rule for reading runs until it stops making progress
+    // (its fd has run dry) or its budget runs out. A write might not be taken, so a rule for writing runs once.
+    for ( unsigned iterations = 1; rule->direction == Direction::In and not rule->fd.blocking(); ++iterations ) {
+      if ( count_before == rule->service_count() or rule->cancel_requested or rule->defunct()
+           or not rule->interested() ) {
+        break;
+      }
+      if ( iterations >= budget.iterations or transferred() - bytes_before >= budget.bytes ) {
+        ++stats.deferred;
+        break;
+      }
+      count_before = rule->service_count();
+      run_callback( *rule );
+    }
+
+    stats.bytes += transferred() - bytes_before;
   }
 }
 
@@ -82,38 +279,53 @@ void EventLoop::RuleHandle::cancel()
 // NOLINTBEGIN(*-signed-bitwise)
 EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
 {
-  // first, handle the non-file-descriptor-related rules
-  {
-    for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
-      auto& this_rule = **it;
-      bool rule_fired = false;
+  // first, the timers that are due
+  bool rule_fired = run_timers();
 
-      if ( this_rule.cancel_requested ) {
-        it = _non_fd_rules.erase( it );
-        continue;
-      }
+  // then the non-file-descriptor-related rules, each while it is interested and its budget allows
+  for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
+    auto& this_rule = **it;
 
-      uint8_t iterations = 0;
-      while ( this_rule.interest() ) {
-        if ( iterations++ >= 128 ) {
-          throw runtime_error( "EventLoop: busy wait detected: rule \""
-                               + _rule_categories.at( this_rule.category_id ).name + "\" is still interested after "
-                               + to_string( iterations ) + " iterations" );
-        }
+    if ( this_rule.cancel_requested ) {
+      it = _non_fd_rules.erase( it );
+      continue;
+    }
 
-        rule_fired = true;
-        this_rule.callback();
+    auto& category = _rule_categories.at( this_rule.category_id );
+    for ( unsigned iterations = 0; this_rule.interested(); ++iterations ) {
+      if ( iterations == category.budget.iterations ) {
+        ++category.stats.deferred; // it runs again on the next call
+        break;
       }
+      rule_fired = true;
+      run_callback( this_rule );
+    }
 
-      if ( rule_fired ) {
-        return Result::Success; /* only serve one rule on each iteration */
-      }
+    ++it;
+  }
 
-      ++it;
-    }
+  // now the file-descriptor-related rules, without waiting if a rule already ran, or past the next timer
+  int fd_timeout_ms = rule_fired ? 0 : timeout_ms;
+  const int timer_ms = ms_until_next_timer();
+  if ( timer_ms >= 0 and ( fd_timeout_ms < 0 or timer_ms < fd_timeout_ms ) ) {
+    fd_timeout_ms = timer_ms;
   }
 
-  // now the file-descriptor-related rules. poll any "interested" file descriptors
+  Result result = _backend == Backend::Poll ? wait_next_event_poll( fd_timeout_ms )
+                                            : wait_next_event_registered( fd_timeout_ms );
+  if ( result == Result::Exit and timer_ms >= 0 ) {
+    // no fds to wait for, but a timer is pending: sleep until it is due
+    CheckSystemCall( "poll", ::poll( nullptr, 0, fd_timeout_ms ) );
+    result = Result::Timeout;
+  }
+
+  rule_fired |= run_timers();
+  return rule_fired ? Result::Success : result;
+}
+
+EventLoop::Result EventLoop::wait_next_event_poll( const int timeout_ms )
+{
+  // poll any "interested" file descriptors
   vector<pollfd> pollfds {};
   pollfds.reserve( _fd_rules.size() );
   bool something_to_poll = false;
@@ -143,7 +355,7 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
       continue;
     }
 
-    if ( this_rule.interest() ) {
+    if ( this_rule.interested() ) {
       pollfds.push_back( { this_rule.fd.fd_num(), static_cast<int16_t>( this_rule.direction ), 0 } );
       something_to_poll = true;
     } else {
@@ -162,7 +374,8 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
     return Result::Timeout;
   }
 
-  // go through the poll results
+  // go through the poll results, collecting the ready rules
+  _ready_rules.clear();
   for ( auto [it, idx] = make_pair( _fd_rules.begin(), static_cast<size_t>( 0 ) ); it != _fd_rules.end(); ++idx ) {
     const auto& this_pollfd = pollfds.at( idx );
     auto& this_rule = **it;
@@ -177,22 +390,7 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
         }
       }
 
-      /* see if fd is a socket */
-      int socket_error = 0;
-      socklen_t optlen = sizeof( socket_error );
-      const int ret = getsockopt( this_rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
-      if ( ret == -1 and errno == ENOTSOCK ) {
-        cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\"\n";
-      } else if ( ret == -1 ) {
-        throw unix_error( "getsockopt" );
-      } else if ( optlen != sizeof( socket_error ) ) {
-        throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
-      } else if ( socket_error ) {
-        cerr << "error on polled socket for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\": " << strerror( socket_error ) << "\n";
-      }
-
+      report_error( this_rule );
       this_rule.cancel();
       it = _fd_rules.erase( it );
       continue;
@@ -212,20 +410,272 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
 
     if ( poll_ready ) {
       // we only want to call callback if revents includes the event we asked for
-      const auto count_before = this_rule.service_count();
-      this_rule.callback();
+      _ready_rules.push_back( *it );
+    }
 
-      if ( count_before == this_rule.service_count() and ( not this_rule.fd.closed() ) and this_rule.interest() ) {
-        throw runtime_error( "EventLoop: busy wait detected: rule \""
-                             + _rule_categories.at( this_rule.category_id ).name
-                             + "\" did not read/write fd and is still interested" );
+    ++it; // if we got here, it means we didn't call _fd_rules.erase()
+  }
+
+  serve( _ready_rules );
+  _ready_rules.clear();
+  return Result::Success;
+}
+
+static uint32_t epoll_events( const EventLoop::Direction direction )
+{
+  return direction == EventLoop::Direction::In ? EPOLLIN : EPOLLOUT;
+}
+
+// The user_data of an IOUring poll: the fd, and which poll for it this is
+static uint64_t poll_id( const int fd_num, const uint32_t arm )
+{
+  return uint64_t { arm } << 32U | static_cast<uint32_t>( fd_num );
+}
+
+void EventLoop::update_registration( const int fd_num, Registration& registration )
+{
+  uint32_t events = 0;
+  for ( const auto& rule : registration.rules ) {
+    if ( rule->armed ) {
+      events |= epoll_events( rule->direction );
+    }
+  }
+
+  // Level-triggered: a rule need not drain its fd, since epoll_wait reports it again if it is still ready (and a
+  // one-shot poll completes at once if its fd is already ready). A registration with no events stays
+  // registered, so that errors and hangups are still reported.
+  if ( _backend == Backend::Epoll ) {
+    epoll_event event {};
+    event.events = events;
+    event.data.fd = fd_num;
+    if ( not registration.added ) {
+      CheckSystemCall( "epoll_ctl", ::epoll_ctl( _epoll->fd_num(), EPOLL_CTL_ADD, fd_num, &event ) );
+      registration.added = true;
+    } else if ( events != registration.events ) {
+      CheckSystemCall( "epoll_ctl", ::epoll_ctl( _epoll->fd_num(), EPOLL_CTL_MOD, fd_num, &event ) );
+    } else {
+      return;
+    }
+  } else if ( registration.arm != 0 and events == registration.events ) {
+    return;
+  }
+
+  if ( registration.events == 0 and events != 0 ) {
+    ++_armed_fds;
+  } else if ( registration.events != 0 and events == 0 ) {
+    --_armed_fds;
+  }
+  registration.events = events;
+
+  if ( _backend == Backend::IOUring ) {
+    arm( fd_num, registration );
+  }
+}
+
+void EventLoop::arm( const int fd_num, Registration& registration )
+{
+  // Replace any poll in flight; if it completes first, its completion is ignored.
+  if ( registration.arm != 0 ) {
+    _uring->prepare_poll_remove( poll_id( fd_num, registration.arm ), 0 );
+  }
+  if ( ++_arms == 0 ) {
+    ++_arms;
+  }
+  registration.arm = _arms;
+  _uring->prepare_poll( fd_num, registration.events, poll_id( fd_num, registration.arm ) );
+}
+
+void EventLoop::remove_rule( shared_ptr<FDRule> rule, const bool call_cancel )
+{
+  const int fd_num = rule->fd.fd_num();
+  const auto registration = _registrations.find( fd_num );
+  if ( registration == _registrations.end() ) {
+    return;
+  }
+  auto& rules = registration->second.rules;
+  const auto it = ranges::find( rules, rule );
+  if ( it == rules.end() ) {
+    return;
+  }
+
+  rules.erase( it );
+  if ( rule->interest ) {
+    erase( _conditional_rules, rule );
+  }
+
+  if ( rules.empty() ) {
+    if ( registration->second.events ) {
+      --_armed_fds;
+    }
+    if ( _backend == Backend::IOUring ) {
+      if ( registration->second.arm != 0 ) {
+        _uring->prepare_poll_remove( poll_id( fd_num, registration->second.arm ), 0 );
       }
+    } else if ( not rule->fd.closed() ) { // closing the fd already removed it
+      CheckSystemCall( "epoll_ctl", ::epoll_ctl( _epoll->fd_num(), EPOLL_CTL_DEL, fd_num, nullptr ) );
+    }
+    _registrations.erase( registration );
+  } else {
+    rule->armed = false;
+    update_registration( fd_num, registration->second );
+  }
 
-      return Result::Success; /* only serve one rule on each iteration */
+  if ( call_cancel ) {
+    rule->cancel();
+  }
+}
+
+void EventLoop::sweep()
+{
+  *_cancellations = false;
+
+  vector<shared_ptr<FDRule>> cancelled;
+  vector<shared_ptr<FDRule>> defunct;
+  for ( const auto& [fd_num, registration] : _registrations ) {
+    for ( const auto& rule : registration.rules ) {
+      if ( rule->cancel_requested ) {
+        cancelled.push_back( rule );
+      } else if ( rule->defunct() ) {
+        defunct.push_back( rule );
+      }
     }
+  }
 
-    ++it; // if we got here, it means we didn't call _fd_rules.erase()
+  // As with poll, a rule cancelled from outside doesn't get its cancel callback.
+  for ( const auto& rule : cancelled ) {
+    remove_rule( rule, false );
+  }
+  for ( const auto& rule : defunct ) {
+    remove_rule( rule, true );
+  }
+}
+
+bool EventLoop::wait_ready( const int timeout_ms )
+{
+  _ready.clear();
+
+  if ( _backend == Backend::Epoll ) {
+    array<epoll_event, 16> events {};
+    const int count = CheckSystemCall(
+      "epoll_wait",
+      ::epoll_wait( _epoll->fd_num(), events.data(), static_cast<int>( events.size() ), timeout_ms ) );
+    for ( const auto& event : span { events }.first( count ) ) {
+      _ready.emplace_back( event.data.fd, event.events );
+    }
+    return count > 0;
+  }
+
+  // Re-arm the polls that completed last time, and wait, in one io_uring_enter
+  for ( const int fd_num : _rearm ) {
+    const auto registration = _registrations.find( fd_num );
+    if ( registration != _registrations.end() and registration->second.arm == 0 ) {
+      arm( fd_num, registration->second );
+    }
+  }
+  _rearm.clear();
+
+  _uring->submit( 1, timeout_ms );
+  _uring->drain( [&]( const uint64_t user_data, const int32_t result ) {
+    const auto fd_num = static_cast<int>( user_data & UINT32_MAX );
+    const auto id = static_cast<uint32_t>( user_data >> 32U );
+    const auto registration = _registrations.find( fd_num );
+    if ( id == 0 or registration == _registrations.end() or registration->second.arm != id ) {
+      return; // a removal, or a poll that has been replaced
+    }
+    registration->second.arm = 0;
+    _rearm.push_back( fd_num );
+    _ready.emplace_back( fd_num, result < 0 ? EPOLLERR : static_cast<uint32_t>( result ) );
+  } );
+  return not _ready.empty();
+}
+
+EventLoop::Result EventLoop::wait_next_event_registered( const int timeout_ms )
+{
+  if ( *_cancellations ) {
+    sweep();
+  }
+
+  // Ask the rules with an interest function, and change the registrations whose events change
+  for ( const auto& rule : vector { _conditional_rules } ) {
+    if ( rule->cancel_requested ) {
+      remove_rule( rule, false );
+    } else if ( rule->defunct() ) {
+      remove_rule( rule, true );
+    } else if ( const bool armed = rule->interested(); armed != rule->armed ) {
+      rule->armed = armed;
+      update_registration( rule->fd.fd_num(), _registrations.at( rule->fd.fd_num() ) );
+    }
+  }
+
+  // quit if there is nothing left to wait for
+  if ( _armed_fds == 0 ) {
+    return Result::Exit;
+  }
+
+  if ( not wait_ready( timeout_ms ) ) {
+    // An fd closed by its owner may never become ready; catch its rules while idle.
+    sweep();
+    return Result::Timeout;
+  }
+
+  for ( const auto& [fd_num, events] : _ready ) {
+    const auto registration = _registrations.find( fd_num );
+    if ( registration == _registrations.end() ) {
+      continue;
+    }
+
+    // A copy, since callbacks and removals change the registration
+    const auto rules = registration->second.rules;
+    for ( const auto& rule : rules ) {
+      if ( rule->cancel_requested ) {
+        remove_rule( rule, false );
+        continue;
+      }
+
+      if ( rule->defunct() ) {
+        remove_rule( rule, true );
+        continue;
+      }
+
+      if ( events & EPOLLERR ) {
+        /* recoverable error? */
+        if ( rule->recover() ) {
+          continue;
+        }
+        report_error( *rule );
+        remove_rule( rule, true );
+        continue;
+      }
+
+      const bool ready = rule->armed and ( events & epoll_events( rule->direction ) );
+      const bool hup = events & EPOLLHUP;
+      if ( hup and ( ( rule->armed and not ready ) or rule->direction == Direction::Out ) ) {
+        // as with poll: a hangup with nothing to read, or on a rule that writes, leaves the fd defunct
+        remove_rule( rule, true );
+        continue;
+      }
+
+      if ( ready ) {
+        _ready_rules.push_back( rule );
+      }
+    }
+  }
+
+  serve( _ready_rules );
+
+  // The callbacks may have closed their fds (which removes them from epoll) or reached EOF.
+  for ( const auto& served : _ready_rules ) {
+    const auto registration = _registrations.find( served->fd.fd_num() );
+    if ( registration == _registrations.end() ) {
+      continue;
+    }
+    for ( const auto& rule : vector { registration->second.rules } ) {
+      if ( rule->defunct() ) {
+        remove_rule( rule, true );
+      }
+    }
   }
+  _ready_rules.clear();
 
   return Result::Success;
 }
@@ -1,13 +1,20 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <limits>
 #include <list>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <poll.h>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "file_descriptor.hh"
+#include "io_uring.hh"
+#include "timer_queue.hh"
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
 class EventLoop
@@ -20,6 +27,43 @@ public:
     Out = POLLOUT //!< Callback will be triggered when Rule::fd is writable.
   };
 
+  //! How EventLoop::wait_next_event waits for the fds.
+  enum class Backend
+  {
+    Poll, //!< Build a pollfd for every rule and call [poll(2)](\ref man2::poll) on each wakeup.
+    Epoll,  //!< Keep every fd registered with [epoll(7)](\ref man7::epoll), and only change the registrations
+            //!< whose interest changed. A wakeup costs O(ready fds + rules with an interest function).
+    IOUring //!< Like Epoll, but register each fd as a one-shot poll in an IOUring. The polls that completed or
+            //!< changed are (re-)submitted by the same io_uring_enter that waits, which also completes the
+            //!< timeout. Falls back to Poll where io_uring is unavailable.
+  };
+
+  //! Returned by each call to EventLoop::wait_next_event.
+  enum class Result
+  {
+    Success, //!< At least one Rule was triggered.
+    Timeout, //!< No rules were triggered before timeout.
+    Exit     //!< All rules have been canceled or were uninterested; make no further calls to
+             //!< EventLoop::wait_next_event.
+  };
+
+  //! How much a rule may do on each call to EventLoop::wait_next_event, set for each category
+  struct Budget
+  {
+    unsigned iterations = 1;                               //!< times the callback may run back to back
+    uint64_t bytes = std::numeric_limits<uint64_t>::max(); //!< (fd rules) bytes it may read or write
+  };
+
+  //! What the rules of a category have done so far
+  struct CategoryStats
+  {
+    uint64_t calls {};                     //!< callbacks run
+    uint64_t bytes {};                     //!< bytes read or written by the callbacks (fd rules)
+    std::chrono::nanoseconds time {};      //!< time spent in the callbacks
+    uint64_t deferred {};                  //!< times a rule was still interested when its budget ran out
+    std::chrono::nanoseconds max_delay {}; //!< longest a ready rule waited for other rules' callbacks
+  };
+
 private:
   using CallbackT = std::function<void( void )>;
   using InterestT = std::function<bool( void )>;
@@ -27,16 +71,21 @@ private:
   struct RuleCategory
   {
     std::string name;
+    Budget budget;
+    CategoryStats stats {};
   };
 
   struct BasicRule
   {
     size_t category_id;
-    InterestT interest;
+    InterestT interest; //!< Empty if the rule is always interested
     CallbackT callback;
     bool cancel_requested {};
+    std::shared_ptr<bool> loop_cancellations {}; //!< Set with cancel_requested, to tell the loop to look
 
     BasicRule( size_t s_category_id, InterestT s_interest, CallbackT s_callback );
+
+    bool interested() const { return not interest or interest(); }
   };
 
   struct FDRule : public BasicRule
@@ -45,6 +94,7 @@ private:
     Direction direction; //!< Direction::In for reading from fd, Direction::Out for writing to fd.
     CallbackT cancel;    //!< A callback that is called when the rule is cancelled (e.g. on hangup)
     InterestT recover;   //!< A callback that is called when the fd is ERR. Returns true to keep rule.
+    bool armed {};       //!< (Epoll/IOUring) Is the rule's direction in its fd's registered events?
 
     FDRule( BasicRule&& base,
             FileDescriptor&& s_fd,
@@ -55,25 +105,93 @@ private:
     //! Returns the number of times fd has been read or written, depending on the value of Rule::direction.
     //! \details This function is used internally by EventLoop; you will not need to call it
     unsigned int service_count() const;
+
+    //! Has the fd closed, or (for Direction::In) reached EOF?
+    bool defunct() const;
+  };
+
+  struct TimerRule : public BasicRule
+  {
+    std::chrono::steady_clock::time_point deadline; //!< when the callback is due
+
+    TimerRule( BasicRule&& base, std::chrono::steady_clock::time_point s_deadline );
+  };
+
+  //! (Epoll/IOUring) The rules on one fd, which are registered once with the union of their directions
+  struct Registration
+  {
+    std::vector<std::shared_ptr<FDRule>> rules {};
+    uint32_t events {}; //!< the registered events
+    bool added {};      //!< (Epoll) has the fd been added to the epoll instance?
+    uint32_t arm {};    //!< (IOUring) id of the poll in flight for the fd, or 0 if none
   };
 
+  Backend _backend;
   std::vector<RuleCategory> _rule_categories {};
-  std::list<std::shared_ptr<FDRule>> _fd_rules {};
+  std::list<std::shared_ptr<FDRule>> _fd_rules {}; // Poll only
   std::list<std::shared_ptr<BasicRule>> _non_fd_rules {};
+  TimerQueue<std::shared_ptr<TimerRule>> _timers {}; // by deadline, in nanoseconds of the steady clock
+
+  std::optional<FileDescriptor> _epoll {};
+  std::optional<IOUring> _uring {};
+  uint32_t _arms {};                                          // (IOUring) last poll id
+  std::vector<int> _rearm {};                                 // (IOUring) fds whose poll completed
+  std::vector<std::pair<int, uint32_t>> _ready {};            // fds and their ready events
+  std::vector<std::shared_ptr<FDRule>> _ready_rules {};       // rules whose fds are ready
+  std::unordered_map<int, Registration> _registrations {};    // by fd number
+  std::vector<std::shared_ptr<FDRule>> _conditional_rules {}; // rules with an interest function
+  size_t _armed_fds {};                                       // registrations with events
+  size_t _first_category {};                                  // which category's ready rules run first
+
+  //! Has a RuleHandle cancelled a rule since the last sweep()?
+  std::shared_ptr<bool> _cancellations { std::make_shared<bool>() };
+
+  //! Print the error on a rule's fd
+  void report_error( const FDRule& rule ) const;
+
+  //! Run a rule's callback once, and add it to its category's stats
+  void run_callback( BasicRule& rule );
+
+  //! Run the timers that are due; returns true if any ran
+  bool run_timers();
+
+  //! Milliseconds (rounded up) until the next timer is due, or -1 if none is pending
+  int ms_until_next_timer();
+
+  //! Run the callbacks of the rules whose fds are ready, round-robin across categories, each as its category's
+  //! budget allows
+  void serve( std::vector<std::shared_ptr<FDRule>>& ready );
+
+  Result wait_next_event_poll( int timeout_ms );
+  Result wait_next_event_registered( int timeout_ms );
+
+  //! (Epoll/IOUring) Wait for registered fds to be ready, and fill _ready; returns false if none are
+  bool wait_ready( int timeout_ms );
+
+  //! (Epoll/IOUring) Make the fd's registered events those of its armed rules
+  void update_registration( int fd_num, Registration& registration );
+
+  //! (IOUring) Prepare a poll for the fd's registered events
+  void arm( int fd_num, Registration& registration );
+
+  //! (Epoll/IOUring) Remove a rule (if it is still there), calling its cancel callback if `call_cancel`
+  void remove_rule( std::shared_ptr<FDRule> rule, bool call_cancel );
+
+  //! (Epoll/IOUring) Remove the rules that were cancelled or whose fd is defunct
+  void sweep();
 
 public:
-  EventLoop() { _rule_categories.reserve( 64 ); }
+  explicit EventLoop( Backend backend = Backend::Poll );
 
-  //! Returned by each call to EventLoop::wait_next_event.
-  enum class Result
-  {
-    Success, //!< At least one Rule was triggered.
-    Timeout, //!< No rules were triggered before timeout.
-    Exit     //!< All rules have been canceled or were uninterested; make no further calls to
-             //!< EventLoop::wait_next_event.
-  };
+  //! Add a category of rules, whose rules each run up to `budget` on each call to wait_next_event
+  size_t add_category( const std::string& name, const Budget& budget );
+  size_t add_category( const std::string& name ) { return add_category( name, Budget {} ); }
+
+  //! The stats of a category's rules
+  const CategoryStats& stats( size_t category_id ) const;
 
-  size_t add_category( const std::string& name );
+  //! Print the stats of every category
+  void print_stats( std::ostream& out ) const;
 
   class RuleHandle
   {
@@ -92,16 +210,28 @@ public:
     FileDescriptor& fd,
     Direction direction,
     const CallbackT& callback,
-    const InterestT& interest = [] { return true; },
+    const InterestT& interest = {},
     const CallbackT& cancel = [] {},
     const InterestT& recover = [] { return false; } );
 
   RuleHandle add_rule(
     size_t category_id,
     const CallbackT& callback,
-    const InterestT& interest = [] { return true; } );
-
-  //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+    const InterestT& interest = {} );
+
+  //! Run `callback` once, at `deadline` or as soon after as the loop gets to it. Cancelling the returned handle
+  //! (before then) stops it from running.
+  RuleHandle add_timer( size_t category_id,
+                        std::chrono::steady_clock::time_point deadline,
+                        const CallbackT& callback );
+
+  //! Runs the timers that are due and the interested non-fd rules, waits for the fds (see Backend), and then runs
+  //! the callbacks of the ready fd rules. Each rule runs up to its category's budget: a non-fd rule while it stays
+  //! interested, and an fd rule for reading (on a non-blocking fd) while its reads make progress; a rule for
+  //! writing runs once.
+  //! \details If a timer or non-fd rule ran, the fds are only checked (with no timeout), so that neither kind
+  //! starves. Otherwise the wait ends by the next timer's deadline, and the timers that are then due run too.
+  //! Pending timers keep the loop from returning Result::Exit.
   Result wait_next_event( int timeout_ms );
 
   // convenience function to add category and rule at the same time
@@ -14,11 +14,16 @@
 class FdAdapterBase
 {
 private:
-  FdAdapterConfig _cfg {}; //!< Configuration values
-  bool _listen = false;    //!< Is the connected TCP FSM in listen state?
+  FdAdapterConfig _cfg {};      //!< Configuration values
+  bool _listen = false;         //!< Is the connected TCP FSM in listen state?
+  uint64_t _cfg_generation = 0; //!< Bumped whenever the configuration may have been changed
 
 protected:
-  FdAdapterConfig& config_mutable() { return _cfg; }
+  FdAdapterConfig& config_mutable()
+  {
+    ++_cfg_generation;
+    return _cfg;
+  }
 
 public:
   //! \brief Set the listening flag
@@ -35,8 +40,22 @@ public:
 
   //! \brief Get the current configuration (mutable)
   //! \returns a mutable reference
-  FdAdapterConfig& config_mut() { return _cfg; }
+  FdAdapterConfig& config_mut()
+  {
+    ++_cfg_generation;
+    return _cfg;
+  }
+
+  //! \brief Get a counter that changes whenever the configuration may have changed
+  //! \details Lets subclasses cache values derived from the configuration.
+  uint64_t config_generation() const { return _cfg_generation; }
 
   //! Called periodically when time elapses
   void tick( const size_t unused [[maybe_unused]] ) {}
+
+  //! Milliseconds until the adapter next needs a tick (never, since it keeps no timers)
+  std::optional<uint64_t> ms_until_deadline() const { return {}; }
+
+  //! Are frames waiting for the device to be writable? (never, since the adapter keeps none)
+  bool has_unsent() const { return false; }
 };
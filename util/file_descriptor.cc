@@ -1,12 +1,15 @@
 #include "file_descriptor.hh"
 
+#include "buffer_pool.hh"
 #include "exception.hh"
 
 #include <algorithm>
+#include <climits>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
 #include <sys/stat.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <unistd.h>
@@ -90,12 +93,13 @@ void FileDescriptor::read( string& buffer )
   const ssize_t bytes_read = ::read( fd_num(), buffer.data(), buffer.size() );
   if ( bytes_read < 0 ) {
     if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      buffer.clear(); // nothing was read
       return;
     }
     throw unix_error { "read" };
   }
 
-  register_read();
+  register_read( bytes_read );
 
   if ( bytes_read == 0 ) {
     internal_fd_->eof_ = true;
@@ -108,6 +112,94 @@ void FileDescriptor::read( string& buffer )
   buffer.resize( bytes_read );
 }
 
+void FileDescriptor::read( Buffer& buffer )
+{
+  // Pooled strings are never shrunk (the Buffer is a slice instead), so this only allocates for a new one.
+  shared_ptr<string> storage = BufferPool::packets().acquire();
+  storage->resize( kReadBufferSize );
+
+  const ssize_t bytes_read = ::read( fd_num(), storage->data(), storage->size() );
+  if ( bytes_read < 0 ) {
+    if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      buffer = Buffer { move( storage ) }.substr( 0, 0 );
+      return;
+    }
+    throw unix_error { "read" };
+  }
+
+  register_read( bytes_read );
+
+  if ( bytes_read == 0 ) {
+    internal_fd_->eof_ = true;
+  }
+
+  if ( bytes_read > static_cast<ssize_t>( storage->size() ) ) {
+    throw runtime_error( "read() read more than requested" );
+  }
+
+  buffer = Buffer { move( storage ) }.substr( 0, bytes_read );
+}
+
+size_t FileDescriptor::read( span<Buffer> packets )
+{
+  if ( packets.empty() ) {
+    return 0;
+  }
+
+  if ( not internal_fd_->not_socket_ ) {
+    vector<shared_ptr<string>> storage;
+    vector<iovec> iovecs;
+    vector<mmsghdr> headers;
+    storage.reserve( packets.size() );
+    iovecs.reserve( packets.size() );
+    headers.reserve( packets.size() );
+    for ( size_t i = 0; i < packets.size(); ++i ) {
+      storage.push_back( BufferPool::packets().acquire() );
+      storage.back()->resize( kReadBufferSize );
+      iovecs.push_back( { storage.back()->data(), storage.back()->size() } );
+      headers.push_back( {} );
+      headers.back().msg_hdr.msg_iov = &iovecs.back();
+      headers.back().msg_hdr.msg_iovlen = 1;
+    }
+
+    // MSG_WAITFORONE: block (if the fd blocks) for the first datagram only
+    const int count
+      = ::recvmmsg( fd_num(), headers.data(), static_cast<unsigned>( headers.size() ), MSG_WAITFORONE, nullptr );
+    if ( count >= 0 or errno != ENOTSOCK ) {
+      if ( count < 0 ) {
+        if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+          return 0;
+        }
+        throw unix_error { "recvmmsg" };
+      }
+
+      size_t received = 0;
+      for ( int i = 0; i < count; ++i ) {
+        packets[i] = Buffer { move( storage[i] ) }.substr( 0, headers[i].msg_len );
+        received += headers[i].msg_len;
+      }
+      register_read( received );
+      return count;
+    }
+
+    // Not a socket (e.g. a TUN device): fall back to one read per datagram from now on.
+    internal_fd_->not_socket_ = true;
+  }
+
+  size_t count = 0;
+  while ( count < packets.size() ) {
+    read( packets[count] );
+    if ( packets[count].empty() ) {
+      break;
+    }
+    ++count;
+    if ( not internal_fd_->non_blocking_ ) {
+      break;
+    }
+  }
+  return count;
+}
+
 void FileDescriptor::read( vector<string>& buffers )
 {
   if ( buffers.empty() ) {
@@ -133,7 +225,7 @@ void FileDescriptor::read( vector<string>& buffers )
     throw unix_error { "read" };
   }
 
-  register_read();
+  register_read( bytes_read );
 
   if ( bytes_read > static_cast<ssize_t>( total_size ) ) {
     throw runtime_error( "read() read more than requested" );
@@ -165,19 +257,73 @@ size_t FileDescriptor::write( const vector<Buffer>& buffers )
   return write( views );
 }
 
+size_t FileDescriptor::write( span<const vector<Buffer>> packets )
+{
+  size_t total_buffers = 0;
+  for ( const auto& packet : packets ) {
+    total_buffers += packet.size();
+  }
+
+  vector<iovec> iovecs;
+  vector<mmsghdr> headers;
+  iovecs.reserve( total_buffers ); // so that the headers' pointers into it stay valid
+  headers.reserve( packets.size() );
+  for ( const auto& packet : packets ) {
+    headers.push_back( {} );
+    headers.back().msg_hdr.msg_iov = iovecs.data() + iovecs.size();
+    headers.back().msg_hdr.msg_iovlen = packet.size();
+    for ( const string_view x : packet ) {
+      iovecs.push_back( { const_cast<char*>( x.data() ), x.size() } ); // NOLINT(*-const-cast)
+    }
+  }
+
+  if ( not internal_fd_->not_socket_ ) {
+    const int count = ::sendmmsg( fd_num(), headers.data(), static_cast<unsigned>( headers.size() ), 0 );
+    if ( count >= 0 or errno != ENOTSOCK ) {
+      CheckSystemCall( "sendmmsg", count );
+      size_t sent = 0;
+      for ( int i = 0; i < count; ++i ) {
+        sent += headers[i].msg_len;
+      }
+      register_write( sent );
+      return max( count, 0 );
+    }
+
+    // Not a socket (e.g. a TUN device): fall back to one write per datagram from now on.
+    internal_fd_->not_socket_ = true;
+  }
+
+  for ( size_t i = 0; i < headers.size(); ++i ) {
+    const msghdr& header = headers[i].msg_hdr;
+    const ssize_t bytes_written = ::writev( fd_num(), header.msg_iov, static_cast<int>( header.msg_iovlen ) );
+    if ( bytes_written < 0 ) {
+      if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+        return i;
+      }
+      throw unix_error { "writev" };
+    }
+    register_write( bytes_written );
+  }
+  return headers.size();
+}
+
 size_t FileDescriptor::write( const vector<string_view>& buffers )
 {
+  // writev(2) accepts at most IOV_MAX regions; anything beyond is left for the caller's next (partial) write.
+  const size_t count = min( buffers.size(), static_cast<size_t>( IOV_MAX ) );
+
   vector<iovec> iovecs;
-  iovecs.reserve( buffers.size() );
+  iovecs.reserve( count );
   size_t total_size = 0;
-  for ( const auto x : buffers ) {
+  for ( size_t i = 0; i < count; ++i ) {
+    const auto x = buffers[i];
     iovecs.push_back( { const_cast<char*>( x.data() ), x.size() } ); // NOLINT(*-const-cast)
     total_size += x.size();
   }
 
   const ssize_t bytes_written
     = CheckSystemCall( "writev", ::writev( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) ) );
-  register_write();
+  register_write( bytes_written );
 
   if ( bytes_written == 0 and total_size != 0 ) {
     throw runtime_error( "write returned 0 given non-empty input buffer" );
@@ -2,8 +2,10 @@
 
 #include "buffer.hh"
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <memory>
+#include <span>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -18,8 +20,11 @@ class FileDescriptor
     bool eof_ = false;          // Flag indicating whether FDWrapper::fd_ is at EOF
     bool closed_ = false;       // Flag indicating whether FDWrapper::fd_ has been closed
     bool non_blocking_ = false; // Flag indicating whether FDWrapper::fd_ is non-blocking
+    bool not_socket_ = false;   // Flag indicating that FDWrapper::fd_ refused recvmmsg/sendmmsg
     unsigned read_count_ = 0;   // The number of times FDWrapper::fd_ has been read
     unsigned write_count_ = 0;  // The numberof times FDWrapper::fd_ has been written
+    uint64_t bytes_read_ = 0;    // The number of bytes read from FDWrapper::fd_
+    uint64_t bytes_written_ = 0; // The number of bytes written to FDWrapper::fd_
 
     // Construct from a file descriptor number returned by the kernel
     explicit FDWrapper( int fd );
@@ -49,8 +54,18 @@ protected:
   static constexpr size_t kReadBufferSize = 16384;
 
   void set_eof() { internal_fd_->eof_ = true; }
-  void register_read() { ++internal_fd_->read_count_; }   // increment read count
-  void register_write() { ++internal_fd_->write_count_; } // increment write count
+  // increment read count, and add to the bytes read
+  void register_read( size_t bytes )
+  {
+    ++internal_fd_->read_count_;
+    internal_fd_->bytes_read_ += bytes;
+  }
+  // increment write count, and add to the bytes written
+  void register_write( size_t bytes )
+  {
+    ++internal_fd_->write_count_;
+    internal_fd_->bytes_written_ += bytes;
+  }
 
   template<typename T>
   T CheckSystemCall( std::string_view s_attempt, T return_value ) const;
@@ -62,15 +77,24 @@ public:
   // Free the std::shared_ptr; the FDWrapper destructor calls close() when the refcount goes to zero.
   ~FileDescriptor() = default;
 
-  // Read into `buffer`
+  // Read into `buffer`, which is resized to the bytes read (none, if a non-blocking fd has nothing to read)
   void read( std::string& buffer );
+  // Read into a string from BufferPool::packets(); `buffer` becomes a slice of it holding the bytes read
+  void read( Buffer& buffer );
   void read( std::vector<std::string>& buffers );
+  // Read up to packets.size() datagrams, one into each Buffer (as read(Buffer&) does), with recvmmsg when the fd
+  // is a socket. Reads past the first only while they would not block, so this never waits for more than one.
+  // Returns the number of datagrams read.
+  size_t read( std::span<Buffer> packets );
 
   // Attempt to write a buffer
   // returns number of bytes written
   size_t write( std::string_view buffer );
   size_t write( const std::vector<std::string_view>& buffers );
   size_t write( const std::vector<Buffer>& buffers );
+  // Write each element of `packets` as one datagram, with sendmmsg when the fd is a socket.
+  // Returns the number of datagrams written, which is fewer than packets.size() only if the fd would block.
+  size_t write( std::span<const std::vector<Buffer>> packets );
 
   // Close the underlying file descriptor
   void close() { internal_fd_->close(); }
@@ -88,8 +112,11 @@ public:
   int fd_num() const { return internal_fd_->fd_; }                        // underlying descriptor number
   bool eof() const { return internal_fd_->eof_; }                         // EOF flag state
   bool closed() const { return internal_fd_->closed_; }                   // closed flag state
+  bool blocking() const { return not internal_fd_->non_blocking_; }       // blocking flag state
   unsigned int read_count() const { return internal_fd_->read_count_; }   // number of reads
   unsigned int write_count() const { return internal_fd_->write_count_; } // number of writes
+  uint64_t bytes_read() const { return internal_fd_->bytes_read_; }       // number of bytes read
+  uint64_t bytes_written() const { return internal_fd_->bytes_written_; } // number of bytes written
 
   // Copy/move constructor/assignment operators
   // FileDescriptor can be moved, but cannot be copied implicitly (see duplicate())
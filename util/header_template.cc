@@ -0,0 +1,111 @@
+#include "header_template.hh"
+#include "checksum.hh"
+
+#include <cstring>
+#include <endian.h>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void store16( char* out, const uint16_t value )
+{
+  const uint16_t big_endian = htobe16( value );
+  memcpy( out, &big_endian, sizeof( big_endian ) );
+}
+
+void store32( char* out, const uint32_t value )
+{
+  const uint32_t big_endian = htobe32( value );
+  memcpy( out, &big_endian, sizeof( big_endian ) );
+}
+
+uint32_t words( const uint32_t value )
+{
+  return ( value >> 16 ) + ( value & 0xffff );
+}
+
+uint16_t fold( uint32_t sum )
+{
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + ( sum & 0xffff );
+  }
+  return sum;
+}
+
+} // namespace
+
+TCPIPv4HeaderTemplate::TCPIPv4HeaderTemplate( const uint32_t src,
+                                              const uint16_t src_port,
+                                              const uint32_t dst,
+                                              const uint16_t dst_port )
+  : src_( src ), src_port_( src_port ), dst_( dst ), dst_port_( dst_port )
+{
+  // IPv4 header, as IPv4Header would serialize it with len, id and cksum left at zero.
+  const IPv4Header ip_header;
+  const uint16_t version_ihl_tos = ( ( ip_header.ver << 4 | ip_header.hlen ) << 8 ) | ip_header.tos;
+  const uint16_t flags_offset = ( ip_header.df ? 0x4000 : 0 ) | ( ip_header.mf ? 0x2000 : 0 ) | ip_header.offset;
+  const uint16_t ttl_proto = ip_header.ttl << 8 | ip_header.proto;
+  store16( &headers_[0], version_ihl_tos );
+  store16( &headers_[6], flags_offset );
+  store16( &headers_[8], ttl_proto );
+  store32( &headers_[12], src );
+  store32( &headers_[16], dst );
+  ip_sum_ = version_ihl_tos + flags_offset + ttl_proto + words( src ) + words( dst );
+
+  // TCP header, with the ports filled in and the urgent pointer zero.
+  store16( &headers_[20], src_port );
+  store16( &headers_[22], dst_port );
+  tcp_sum_ = words( src ) + words( dst ) + ip_header.proto + src_port + dst_port;
+}
+
+uint16_t TCPIPv4HeaderTemplate::write( array<char, LENGTH>& out, const TCPSegment& seg, const uint16_t id ) const
+{
+  out = headers_;
+
+  const auto tcp_length = static_cast<uint16_t>( TCPSegment::HEADER_LENGTH + seg.sender_message.payload.size() );
+  const auto ip_length = static_cast<uint16_t>( IPv4Header::LENGTH + tcp_length );
+  const uint16_t ip_cksum = ~fold( ip_sum_ + ip_length + id );
+  store16( &out[2], ip_length );
+  store16( &out[4], id );
+  store16( &out[10], ip_cksum );
+
+  const uint32_t seqno = Wrap32Serializable { seg.sender_message.seqno }.raw_value();
+  const uint32_t ackno = Wrap32Serializable { seg.receiver_message.ackno.value_or( Wrap32 { 0 } ) }.raw_value();
+  const uint16_t offset_flags = ( TCPSegment::HEADER_LENGTH / 4 ) << 12 | seg.flags();
+  const uint16_t window = seg.receiver_message.window_size;
+  store32( &out[24], seqno );
+  store32( &out[28], ackno );
+  store16( &out[32], offset_flags );
+  store16( &out[34], window );
+
+  // The pseudo-header's length counts the TCP header and payload.
+  InternetChecksum check { tcp_sum_ + tcp_length + words( seqno ) + words( ackno ) + offset_flags + window };
+  check.add( seg.sender_message.payload );
+  store16( &out[36], check.value() );
+
+  return ip_cksum;
+}
+
+InternetDatagram TCPIPv4HeaderTemplate::wrap( const TCPSegment& seg, const uint16_t id ) const
+{
+  array<char, LENGTH> headers;
+  InternetDatagram dgram;
+  dgram.header.cksum = write( headers, seg, id );
+  dgram.header.len = IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + seg.sender_message.payload.size();
+  dgram.header.id = id;
+  dgram.header.src = src_;
+  dgram.header.dst = dst_;
+
+  dgram.payload.emplace_back( string { headers.begin() + IPv4Header::LENGTH, headers.end() } );
+  dgram.payload.push_back( seg.sender_message.payload );
+  return dgram;
+}
+
+vector<Buffer> TCPIPv4HeaderTemplate::serialize( const TCPSegment& seg, const uint16_t id ) const
+{
+  array<char, LENGTH> headers;
+  write( headers, seg, id );
+  return { string { headers.begin(), headers.end() }, seg.sender_message.payload };
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ipv4_datagram.hh"
+#include "tcp_segment.hh"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+//! \brief The IPv4 and TCP headers of one TCP flow, serialized once
+//! \details Everything but the per-segment fields (lengths, IP ID, sequence and acknowledgment numbers,
+//! flags, window and checksums) is fixed for a flow. Each segment's headers are a copy of the template
+//! with those fields stored in place, and both checksums start from precomputed sums of the fixed words,
+//! so only the payload is summed per segment.
+class TCPIPv4HeaderTemplate
+{
+public:
+  static constexpr size_t LENGTH = IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH;
+
+private:
+  std::array<char, LENGTH> headers_ {};
+  uint32_t src_;
+  uint16_t src_port_;
+  uint32_t dst_;
+  uint16_t dst_port_;
+  uint32_t ip_sum_ {};  //!< one's complement sum of the fixed IPv4 header words
+  uint32_t tcp_sum_ {}; //!< ... of the fixed pseudo-header and TCP header words
+
+  //! Write the patched headers for `seg` to `out`; returns the IPv4 header checksum
+  uint16_t write( std::array<char, LENGTH>& out, const TCPSegment& seg, uint16_t id ) const;
+
+public:
+  //! Build the template for segments from src:src_port to dst:dst_port
+  TCPIPv4HeaderTemplate( uint32_t src, uint16_t src_port, uint32_t dst, uint16_t dst_port );
+
+  //! An IPv4 datagram carrying `seg`, with the TCP header already serialized into its payload
+  InternetDatagram wrap( const TCPSegment& seg, uint16_t id = 0 ) const;
+
+  //! The serialized IPv4 datagram carrying `seg`: the two headers, then the TCP payload
+  std::vector<Buffer> serialize( const TCPSegment& seg, uint16_t id = 0 ) const;
+
+  uint16_t src_port() const { return src_port_; }
+  uint16_t dst_port() const { return dst_port_; }
+};
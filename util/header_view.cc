@@ -0,0 +1,184 @@
+#include "header_view.hh"
+#include "checksum.hh"
+#include "parser.hh"
+
+#include <array>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+template<std::unsigned_integral T>
+T load( const string_view data, const size_t offset )
+{
+  T raw;
+  memcpy( &raw, data.data() + offset, sizeof( T ) );
+  return network_order( raw );
+}
+
+} // namespace
+
+optional<IPv4HeaderView> IPv4HeaderView::parse( const string_view data )
+{
+  if ( data.size() < IPv4Header::LENGTH ) {
+    return {};
+  }
+
+  const IPv4HeaderView view { data };
+  if ( view.ver() != 4 or view.hlen() < 5 or data.size() < view.header_length() ) {
+    return {};
+  }
+
+  // Like IPv4Header::parse, check the checksum of the fixed part of the header as IPv4Header would serialize
+  // it, which drops the reserved flag bit.
+  array<char, IPv4Header::LENGTH> fixed {};
+  memcpy( fixed.data(), data.data(), fixed.size() );
+  fixed[6] &= 0x7f;
+  fixed[10] = fixed[11] = 0;
+  InternetChecksum check;
+  check.add( { fixed.data(), fixed.size() } );
+  if ( check.value() != view.cksum() ) {
+    return {};
+  }
+
+  return IPv4HeaderView { data.substr( 0, view.header_length() ) };
+}
+
+uint8_t IPv4HeaderView::ver() const
+{
+  return load<uint8_t>( data_, 0 ) >> 4;
+}
+
+uint8_t IPv4HeaderView::hlen() const
+{
+  return load<uint8_t>( data_, 0 ) & 0x0f;
+}
+
+uint8_t IPv4HeaderView::tos() const
+{
+  return load<uint8_t>( data_, 1 );
+}
+
+uint16_t IPv4HeaderView::len() const
+{
+  return load<uint16_t>( data_, 2 );
+}
+
+uint16_t IPv4HeaderView::id() const
+{
+  return load<uint16_t>( data_, 4 );
+}
+
+bool IPv4HeaderView::df() const
+{
+  return load<uint16_t>( data_, 6 ) & 0x4000;
+}
+
+bool IPv4HeaderView::mf() const
+{
+  return load<uint16_t>( data_, 6 ) & 0x2000;
+}
+
+uint16_t IPv4HeaderView::offset() const
+{
+  return load<uint16_t>( data_, 6 ) & 0x1fff;
+}
+
+uint8_t IPv4HeaderView::ttl() const
+{
+  return load<uint8_t>( data_, 8 );
+}
+
+uint8_t IPv4HeaderView::proto() const
+{
+  return load<uint8_t>( data_, 9 );
+}
+
+uint16_t IPv4HeaderView::cksum() const
+{
+  return load<uint16_t>( data_, 10 );
+}
+
+uint32_t IPv4HeaderView::src() const
+{
+  return load<uint32_t>( data_, 12 );
+}
+
+uint32_t IPv4HeaderView::dst() const
+{
+  return load<uint32_t>( data_, 16 );
+}
+
+IPv4Header IPv4HeaderView::header() const
+{
+  IPv4Header header;
+  header.ver = ver();
+  header.hlen = hlen();
+  header.tos = tos();
+  header.len = len();
+  header.id = id();
+  header.df = df();
+  header.mf = mf();
+  header.offset = offset();
+  header.ttl = ttl();
+  header.proto = proto();
+  header.cksum = cksum();
+  header.src = src();
+  header.dst = dst();
+  return header;
+}
+
+optional<TCPHeaderView> TCPHeaderView::parse( const string_view data )
+{
+  if ( data.size() < TCPSegment::HEADER_LENGTH ) {
+    return {};
+  }
+
+  const TCPHeaderView view { data };
+  if ( view.header_length() < TCPSegment::HEADER_LENGTH or data.size() < view.header_length() ) {
+    return {};
+  }
+
+  return TCPHeaderView { data.substr( 0, view.header_length() ) };
+}
+
+uint16_t TCPHeaderView::src_port() const
+{
+  return load<uint16_t>( data_, 0 );
+}
+
+uint16_t TCPHeaderView::dst_port() const
+{
+  return load<uint16_t>( data_, 2 );
+}
+
+Wrap32 TCPHeaderView::seqno() const
+{
+  return Wrap32 { load<uint32_t>( data_, 4 ) };
+}
+
+Wrap32 TCPHeaderView::ackno() const
+{
+  return Wrap32 { load<uint32_t>( data_, 8 ) };
+}
+
+uint8_t TCPHeaderView::data_offset() const
+{
+  return load<uint8_t>( data_, 12 ) >> 4;
+}
+
+uint8_t TCPHeaderView::flags() const
+{
+  return load<uint8_t>( data_, 13 );
+}
+
+uint16_t TCPHeaderView::window_size() const
+{
+  return load<uint16_t>( data_, 14 );
+}
+
+uint16_t TCPHeaderView::cksum() const
+{
+  return load<uint16_t>( data_, 16 );
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ipv4_header.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+//! \brief A serialized IPv4 header, read in place
+//! \details Fields are loaded straight from the wire bytes, so checking where a datagram is going costs a
+//! few loads instead of a full IPv4Header::parse. The view does not own the bytes it refers to.
+class IPv4HeaderView
+{
+  std::string_view data_;
+
+  explicit IPv4HeaderView( std::string_view data ) : data_( data ) {}
+
+public:
+  //! A view of the IPv4 header at the start of `data`, if the whole header (with any options) is there and
+  //! its version, header length and checksum are valid, as IPv4Header::parse would require
+  static std::optional<IPv4HeaderView> parse( std::string_view data );
+
+  uint8_t ver() const;
+  uint8_t hlen() const;
+  uint8_t tos() const;
+  uint16_t len() const;
+  uint16_t id() const;
+  bool df() const;
+  bool mf() const;
+  uint16_t offset() const;
+  uint8_t ttl() const;
+  uint8_t proto() const;
+  uint16_t cksum() const;
+  uint32_t src() const;
+  uint32_t dst() const;
+
+  //! Length of the header, including options
+  size_t header_length() const { return hlen() * 4UL; }
+
+  //! The header as IPv4Header::parse would have produced it
+  IPv4Header header() const;
+};
+
+//! \brief A serialized TCP header, read in place
+//! \details Only the header's layout is checked; the checksum covers the whole segment and is verified by
+//! TCPSegment::parse, so a segment rejected by port never has its payload summed.
+class TCPHeaderView
+{
+  std::string_view data_;
+
+  explicit TCPHeaderView( std::string_view data ) : data_( data ) {}
+
+public:
+  //! A view of the TCP header at the start of `data`, if the whole header (with any options) is there
+  static std::optional<TCPHeaderView> parse( std::string_view data );
+
+  uint16_t src_port() const;
+  uint16_t dst_port() const;
+  Wrap32 seqno() const;
+  Wrap32 ackno() const;
+  uint8_t data_offset() const;
+  uint8_t flags() const;
+  uint16_t window_size() const;
+  uint16_t cksum() const;
+
+  bool ACK() const { return flags() & 0b0001'0000; }
+  bool RST() const { return flags() & 0b0000'0100; }
+  bool SYN() const { return flags() & 0b0000'0010; }
+  bool FIN() const { return flags() & 0b0000'0001; }
+
+  //! Length of the header, including options
+  size_t header_length() const { return data_offset() * 4UL; }
+};
@@ -0,0 +1,187 @@
+#include "io_uring.hh"
+
+#include "exception.hh"
+
+#include <csignal>
+#include <ctime>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+void IOUring::Unmap::operator()( void* addr ) const
+{
+  ::munmap( addr, length );
+}
+
+namespace {
+
+int setup( const unsigned entries, io_uring_params& params )
+{
+  return CheckSystemCall( "io_uring_setup",
+                          static_cast<int>( ::syscall( __NR_io_uring_setup, entries, &params ) ) );
+}
+
+// A pointer `offset` bytes into a mapped region
+template<typename T>
+T* at( void* region, const unsigned offset )
+{
+  return reinterpret_cast<T*>( static_cast<char*>( region ) + offset ); // NOLINT(*-reinterpret-cast, *-arithmetic)
+}
+
+} // namespace
+
+IOUring::IOUring( const unsigned entries ) : _ring( setup( entries, _params ) )
+{
+  if ( not( _params.features & IORING_FEAT_EXT_ARG ) ) { // NOLINT(*-signed-bitwise)
+    throw runtime_error( "io_uring: the kernel does not support waiting with a timeout (IORING_FEAT_EXT_ARG)" );
+  }
+
+  const auto map = [&]( const size_t length, const off_t offset ) {
+    void* const addr
+      = ::mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring.fd_num(), offset );
+    if ( addr == MAP_FAILED ) { // NOLINT(*-cstyle-cast, *-int-to-ptr)
+      throw unix_error { "mmap" };
+    }
+    return Region { addr, Unmap { length } };
+  };
+
+  size_t sq_length = _params.sq_off.array + _params.sq_entries * sizeof( unsigned );
+  const size_t cq_length = _params.cq_off.cqes + _params.cq_entries * sizeof( io_uring_cqe );
+  const bool single_mmap = _params.features & IORING_FEAT_SINGLE_MMAP; // NOLINT(*-signed-bitwise)
+  if ( single_mmap ) {
+    sq_length = max( sq_length, cq_length );
+  }
+
+  _sq_region = map( sq_length, IORING_OFF_SQ_RING );
+  if ( not single_mmap ) {
+    _cq_region = map( cq_length, IORING_OFF_CQ_RING );
+  }
+  _sqe_region = map( _params.sq_entries * sizeof( io_uring_sqe ), IORING_OFF_SQES );
+
+  void* const sq = _sq_region.get();
+  void* const cq = single_mmap ? sq : _cq_region.get();
+  _sq_head = at<unsigned>( sq, _params.sq_off.head );
+  _sq_tail = at<unsigned>( sq, _params.sq_off.tail );
+  _sq_array = at<unsigned>( sq, _params.sq_off.array );
+  _sqes = static_cast<io_uring_sqe*>( _sqe_region.get() );
+  _cq_head = at<unsigned>( cq, _params.cq_off.head );
+  _cq_tail = at<unsigned>( cq, _params.cq_off.tail );
+  _cqes = at<io_uring_cqe>( cq, _params.cq_off.cqes );
+}
+
+bool IOUring::supported()
+{
+  static const bool result = [] {
+    try {
+      const IOUring probe { 2 };
+      return true;
+    } catch ( const exception& ) {
+      return false;
+    }
+  }();
+  return result;
+}
+
+io_uring_sqe& IOUring::next_sqe()
+{
+  if ( _prepared == _params.sq_entries ) {
+    submit();
+  }
+
+  // The kernel consumes entries as they are submitted, so after submit() the whole queue is free.
+  const unsigned tail = *_sq_tail + _prepared;
+  const unsigned index = tail & ( _params.sq_entries - 1 );
+  _sq_array[index] = index; // NOLINT(*-pointer-arithmetic)
+  ++_prepared;
+
+  io_uring_sqe& sqe = _sqes[index]; // NOLINT(*-pointer-arithmetic)
+  sqe = {};
+  return sqe;
+}
+
+void IOUring::prepare_poll( const int fd, const uint32_t events, const uint64_t user_data )
+{
+  io_uring_sqe& sqe = next_sqe();
+  sqe.opcode = IORING_OP_POLL_ADD;
+  sqe.fd = fd;
+  sqe.poll32_events = events;
+  sqe.user_data = user_data;
+}
+
+void IOUring::prepare_poll_remove( const uint64_t target, const uint64_t user_data )
+{
+  io_uring_sqe& sqe = next_sqe();
+  sqe.opcode = IORING_OP_POLL_REMOVE;
+  sqe.fd = -1;
+  sqe.addr = target;
+  sqe.user_data = user_data;
+}
+
+void IOUring::prepare_read( const int fd, const span<char> buffer, const uint64_t user_data, const bool link )
+{
+  io_uring_sqe& sqe = next_sqe();
+  sqe.opcode = IORING_OP_READ;
+  sqe.fd = fd;
+  sqe.addr = reinterpret_cast<uint64_t>( buffer.data() ); // NOLINT(*-reinterpret-cast)
+  sqe.len = buffer.size();
+  sqe.off = -1; // the current file position, as read(2) uses
+  sqe.flags = link ? IOSQE_IO_LINK : 0;
+  sqe.user_data = user_data;
+}
+
+void IOUring::prepare_writev( const int fd,
+                              const span<const iovec> iovecs,
+                              const uint64_t user_data,
+                              const bool link )
+{
+  io_uring_sqe& sqe = next_sqe();
+  sqe.opcode = IORING_OP_WRITEV;
+  sqe.fd = fd;
+  sqe.addr = reinterpret_cast<uint64_t>( iovecs.data() ); // NOLINT(*-reinterpret-cast)
+  sqe.len = iovecs.size();
+  sqe.off = -1;
+  sqe.flags = link ? IOSQE_IO_LINK : 0;
+  sqe.user_data = user_data;
+}
+
+bool IOUring::submit( const unsigned wait_for, const int timeout_ms )
+{
+  // Publish the prepared entries to the kernel
+  atomic_ref { *_sq_tail }.store( *_sq_tail + _prepared, memory_order_release );
+  if ( _prepared == 0 and wait_for == 0 ) {
+    return true;
+  }
+  return enter( wait_for, timeout_ms );
+}
+
+bool IOUring::enter( const unsigned wait_for, const int timeout_ms )
+{
+  __kernel_timespec timeout {};
+  io_uring_getevents_arg arg {};
+  arg.sigmask_sz = _NSIG / 8;
+  if ( timeout_ms >= 0 ) {
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = ( timeout_ms % 1000 ) * 1000000L;
+    arg.ts = reinterpret_cast<uint64_t>( &timeout ); // NOLINT(*-reinterpret-cast)
+  }
+
+  const unsigned to_submit = _prepared;
+  _prepared = 0;
+  const unsigned flags = IORING_ENTER_EXT_ARG | ( wait_for ? IORING_ENTER_GETEVENTS : 0 );
+  const long ret
+    = ::syscall( __NR_io_uring_enter, _ring.fd_num(), to_submit, wait_for, flags, &arg, sizeof( arg ) );
+  ++_enters;
+  if ( ret < 0 ) {
+    if ( errno == ETIME or errno == EINTR ) {
+      return false;
+    }
+    throw unix_error { "io_uring_enter" };
+  }
+  if ( static_cast<unsigned>( ret ) != to_submit ) {
+    throw runtime_error( "io_uring_enter submitted " + to_string( ret ) + " of " + to_string( to_submit ) );
+  }
+  return true;
+}
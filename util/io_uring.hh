@@ -0,0 +1,99 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <memory>
+#include <span>
+#include <sys/uio.h>
+
+//! \brief A minimal [io_uring](\ref man7::io_uring) instance, driven with the raw system calls
+//! \details Operations are prepared into the submission queue, submitted together by one submit() (which can
+//! also wait for completions), and their completions are consumed with drain(). Each operation carries a
+//! caller-chosen `user_data`, which its completion returns.
+class IOUring
+{
+  //! An mmap(2)ed region of the ring, unmapped on destruction
+  struct Unmap
+  {
+    size_t length;
+    void operator()( void* addr ) const;
+  };
+  using Region = std::unique_ptr<void, Unmap>;
+
+  io_uring_params _params {};
+  FileDescriptor _ring;
+  Region _sq_region { nullptr, Unmap { 0 } };
+  Region _cq_region { nullptr, Unmap { 0 } }; // empty if the kernel maps both rings together
+  Region _sqe_region { nullptr, Unmap { 0 } };
+
+  unsigned* _sq_head {};
+  unsigned* _sq_tail {};
+  unsigned* _sq_array {};
+  io_uring_sqe* _sqes {};
+
+  unsigned* _cq_head {};
+  unsigned* _cq_tail {};
+  io_uring_cqe* _cqes {};
+
+  unsigned _prepared {}; // prepared but not yet submitted
+  uint64_t _enters {};
+
+  //! The next free submission queue entry (submitting the prepared ones first if the queue is full)
+  io_uring_sqe& next_sqe();
+
+  //! Call io_uring_enter; returns false if the wait timed out
+  bool enter( unsigned wait_for, int timeout_ms );
+
+public:
+  //! Set up a ring with room for `entries` operations in flight (throws unix_error if io_uring is unavailable)
+  explicit IOUring( unsigned entries );
+
+  //! Can this process set up an io_uring with the features IOUring needs? (Checked once.)
+  static bool supported();
+
+  //! Wait until `fd` has any of `events` (or an error or hangup), reported as poll(2) revents
+  void prepare_poll( int fd, uint32_t events, uint64_t user_data );
+  //! Cancel the poll prepared with `target` as its user_data
+  void prepare_poll_remove( uint64_t target, uint64_t user_data );
+  //! Read into `buffer`, which must stay valid until the read completes
+  void prepare_read( int fd, std::span<char> buffer, uint64_t user_data, bool link = false );
+  //! Write the regions, which must stay valid until the write completes (the iovec array only until submit())
+  //! \details With `link`, the next operation prepared starts only if this one writes everything.
+  void prepare_writev( int fd, std::span<const iovec> iovecs, uint64_t user_data, bool link = false );
+
+  //! Submit the prepared operations, and wait until at least `wait_for` completions are ready or `timeout_ms`
+  //! milliseconds pass (-1: no timeout)
+  //! \returns false if the wait timed out
+  bool submit( unsigned wait_for = 0, int timeout_ms = -1 );
+
+  //! Consume the completions that are ready, calling f( user_data, result ) for each (the result is what the
+  //! system call would have returned, or -errno)
+  //! \returns the number of completions
+  template<class F>
+  size_t drain( F&& f );
+
+  uint64_t enters() const { return _enters; } //!< number of io_uring_enter calls so far
+
+  IOUring( const IOUring& other ) = delete;
+  IOUring& operator=( const IOUring& other ) = delete;
+  IOUring( IOUring&& other ) = delete;
+  IOUring& operator=( IOUring&& other ) = delete;
+  ~IOUring() = default;
+};
+
+template<class F>
+size_t IOUring::drain( F&& f )
+{
+  unsigned head = *_cq_head;
+  const unsigned tail = std::atomic_ref { *_cq_tail }.load( std::memory_order_acquire );
+  const size_t count = tail - head;
+  for ( ; head != tail; ++head ) {
+    const io_uring_cqe& cqe = _cqes[head & ( _params.cq_entries - 1 )]; // NOLINT(*-pointer-arithmetic)
+    f( cqe.user_data, cqe.res );
+  }
+  std::atomic_ref { *_cq_head }.store( head, std::memory_order_release );
+  return count;
+}
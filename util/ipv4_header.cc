@@ -61,6 +61,8 @@ void IPv4Header::serialize( Serializer& serializer ) const
     throw runtime_error( "wrong IP version" );
   }
 
+  serializer.reserve( LENGTH );
+
   const uint8_t first_byte = ( static_cast<uint32_t>( ver ) << 4 ) | ( hlen & 0xfU );
   serializer.integer( first_byte ); // version and header length
   serializer.integer( tos );
@@ -104,18 +106,44 @@ uint32_t IPv4Header::pseudo_checksum() const
   return pcksum;
 }
 
+//! \details Sums the header's 16-bit words as serialize() would write them, without serializing.
 void IPv4Header::compute_checksum()
 {
-  cksum = 0;
-  Serializer s;
-  serialize( s );
+  if ( ver != 4 ) {
+    throw runtime_error( "wrong IP version" );
+  }
+
+  const uint32_t first_word = ( ( static_cast<uint32_t>( ver ) << 4 | ( hlen & 0xfU ) ) << 8 ) | tos;
+  const uint32_t fo_val = ( df ? 0x4000U : 0 ) | ( mf ? 0x2000U : 0 ) | ( offset & 0x1fffU );
+  const uint32_t ttl_proto = static_cast<uint32_t>( ttl ) << 8 | proto;
 
-  // calculate checksum -- taken over header only
-  InternetChecksum check;
-  check.add( s.output() );
+  // calculate checksum -- taken over header only, with the checksum field zero
+  InternetChecksum check { first_word + len + id + fo_val + ttl_proto + ( src >> 16 ) + ( src & 0xffff )
+                           + ( dst >> 16 ) + ( dst & 0xffff ) };
   cksum = check.value();
 }
 
+//! \details Uses eqn. 3 of [RFC 1624](\ref rfc::rfc1624), HC' = ~(~HC + ~m + m'), which never yields
+//! a checksum of 0xffff and so agrees with compute_checksum().
+void IPv4Header::update_checksum( const uint16_t old_word, const uint16_t new_word )
+{
+  uint32_t sum = static_cast<uint16_t>( ~cksum );
+  sum += static_cast<uint16_t>( ~old_word );
+  sum += new_word;
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + static_cast<uint16_t>( sum );
+  }
+  cksum = ~sum;
+}
+
+void IPv4Header::decrement_ttl()
+{
+  // TTL shares a 16-bit header word with the protocol field.
+  const uint16_t old_word = ( static_cast<uint16_t>( ttl ) << 8 ) | proto;
+  ttl -= 1;
+  update_checksum( old_word, ( static_cast<uint16_t>( ttl ) << 8 ) | proto );
+}
+
 std::string IPv4Header::to_string() const
 {
   stringstream ss {};
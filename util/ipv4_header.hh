@@ -57,6 +57,12 @@ struct IPv4Header
   // Set checksum to correct value
   void compute_checksum();
 
+  // Adjust the checksum for one 16-bit header word changing from `old_word` to `new_word` (RFC 1624)
+  void update_checksum( uint16_t old_word, uint16_t new_word );
+
+  // Decrement the TTL, updating the checksum incrementally instead of recomputing it
+  void decrement_ttl();
+
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
@@ -5,9 +5,12 @@
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 
+#include <algorithm>
 #include <optional>
 #include <random>
+#include <span>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template<typename AdapterT>
@@ -49,6 +52,17 @@ public:
     return ret;
   }
 
+  //! \brief Read a batch from the underlying AdapterT instance, potentially dropping each segment read
+  void read_batch( std::vector<TCPSegment>& segments, size_t max_datagrams )
+  {
+    const auto first_new = static_cast<std::ptrdiff_t>( segments.size() );
+    _adapter.read_batch( segments, max_datagrams );
+    segments.erase( std::remove_if( segments.begin() + first_new,
+                                    segments.end(),
+                                    [&]( const TCPSegment& ) { return _should_drop( false ); } ),
+                    segments.end() );
+  }
+
   //! \brief Write to the underlying AdapterT instance, potentially dropping the datagram to be written
   //! \param[in] seg is the packet to either write or drop
   void write( TCPSegment& seg )
@@ -59,6 +73,28 @@ public:
     return _adapter.write( seg );
   }
 
+  //! \brief Write a batch to the underlying AdapterT instance, potentially dropping each segment
+  //! \returns the number of segments written or dropped
+  size_t write_batch( std::span<TCPSegment> segments )
+  {
+    size_t done = 0;
+    while ( done < segments.size() ) {
+      // Write the run of segments up to the next one to drop
+      size_t end = done;
+      while ( end < segments.size() and not _should_drop( true ) ) {
+        ++end;
+      }
+      if ( end > done ) {
+        const size_t written = _adapter.write_batch( segments.subspan( done, end - done ) );
+        if ( written < end - done ) {
+          return done + written;
+        }
+      }
+      done = std::min( end + 1, segments.size() ); // skip the segment to drop
+    }
+    return done;
+  }
+
   //! \name
   //! Passthrough functions to the underlying AdapterT instance
 
@@ -66,4 +102,6 @@ public:
   const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
   FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
   void tick( const size_t ms_since_last_tick ) { _adapter.tick( ms_since_last_tick ); }
+  std::optional<uint64_t> ms_until_deadline() const { return _adapter.ms_until_deadline(); }
+  bool has_unsent() const { return _adapter.has_unsent(); }
 };
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "buffer.hh"
+#include "buffer_pool.hh"
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <concepts>
 #include <cstdint>
 #include <cstring>
-#include <deque>
+#include <memory>
 #include <numeric>
 #include <span>
 #include <stdexcept>
@@ -16,21 +19,47 @@
 
 class Serializer;
 
+// Convert an integer between host and network (big-endian) byte order
+template<std::unsigned_integral T>
+constexpr T network_order( const T value )
+{
+  if constexpr ( std::endian::native == std::endian::big or sizeof( T ) == 1 ) {
+    return value;
+  } else if constexpr ( sizeof( T ) == 2 ) {
+    return __builtin_bswap16( value );
+  } else if constexpr ( sizeof( T ) == 4 ) {
+    return __builtin_bswap32( value );
+  } else {
+    return __builtin_bswap64( value );
+  }
+}
+
 class Parser
 {
   class BufferList
   {
     uint64_t size_ {};
-    std::deque<Buffer> buffer_ {};
+    std::vector<Buffer> buffers_ {};
+    size_t head_ {}; // buffers_[head_] is the first buffer not yet fully consumed
     uint64_t skip_ {};
 
+    // Move past any fully consumed (or empty) buffers
+    void advance()
+    {
+      while ( head_ < buffers_.size() and skip_ == buffers_[head_].size() ) {
+        ++head_;
+        skip_ = 0;
+      }
+    }
+
   public:
     // NOLINTNEXTLINE(*-explicit-*)
-    BufferList( const std::vector<Buffer>& buffers )
+    BufferList( std::vector<Buffer> buffers ) : buffers_( std::move( buffers ) )
     {
-      for ( const auto& x : buffers ) {
-        append( x );
+      for ( const auto& x : buffers_ ) {
+        size_ += x.size();
       }
+      advance();
     }
 
     uint64_t size() const { return size_; }
@@ -39,62 +68,70 @@ class Parser
 
     std::string_view peek() const
     {
-      if ( buffer_.empty() ) {
+      if ( head_ == buffers_.size() ) {
         throw std::runtime_error( "peek on empty BufferList" );
       }
-      return std::string_view { buffer_.front() }.substr( skip_ );
+      return std::string_view { buffers_[head_] }.substr( skip_ );
     }
 
     void remove_prefix( uint64_t len )
     {
-      while ( len and not buffer_.empty() ) {
+      while ( len and head_ < buffers_.size() ) {
         const uint64_t to_pop_now = std::min( len, peek().size() );
         skip_ += to_pop_now;
         len -= to_pop_now;
         size_ -= to_pop_now;
-        if ( skip_ == buffer_.front().size() ) {
-          buffer_.pop_front();
-          skip_ = 0;
-        }
+        advance();
+      }
+    }
+
+    // Call `f` with each remaining piece of the input, in order, without copying it
+    template<class F>
+    void for_each( F&& f ) const
+    {
+      for ( size_t i = head_; i < buffers_.size(); ++i ) {
+        f( i == head_ ? peek() : std::string_view { buffers_[i] } );
       }
     }
 
+    // The remaining buffers share storage with the input, including what is left of a partly consumed one
     void dump_all( std::vector<Buffer>& out )
     {
       out.clear();
       if ( empty() ) {
         return;
       }
-      std::string first_str = std::move( buffer_.front() );
       if ( skip_ ) {
-        first_str = first_str.substr( skip_ );
-      }
-      out.emplace_back( std::move( first_str ) );
-      buffer_.pop_front();
-      for ( auto&& x : buffer_ ) {
-        out.emplace_back( std::move( x ) );
+        buffers_[head_] = buffers_[head_].substr( skip_ );
+        skip_ = 0;
       }
+      buffers_.erase( buffers_.begin(), buffers_.begin() + static_cast<ptrdiff_t>( head_ ) );
+      out = std::move( buffers_ );
+      buffers_.clear();
+      head_ = 0;
+      size_ = 0;
     }
 
+    // Shares storage with the input unless the remaining bytes span several buffers, or are few enough that
+    // Buffer::compact() copies them
     void dump_all( Buffer& out )
     {
-      std::vector<Buffer> concat;
-      dump_all( concat );
-      if ( concat.size() == 1 ) {
-        out = concat.front();
+      if ( empty() ) {
+        out = Buffer {};
         return;
       }
 
-      out.release().clear();
-      for ( const auto& s : concat ) {
-        out.release().append( s );
+      if ( peek().size() == size_ ) {
+        out = buffers_[head_].substr( skip_ ).compact();
+      } else {
+        std::string joined;
+        joined.reserve( size_ );
+        for_each( [&]( const std::string_view piece ) { joined.append( piece ); } );
+        out = Buffer { std::move( joined ) };
       }
-    }
-
-    void append( Buffer str )
-    {
-      size_ += str.size();
-      buffer_.push_back( std::move( str ) );
+      head_ = buffers_.size();
+      skip_ = 0;
+      size_ = 0;
     }
   };
 
@@ -109,7 +146,7 @@ class Parser
   }
 
 public:
-  explicit Parser( const std::vector<Buffer>& input ) : input_( input ) {}
+  explicit Parser( std::vector<Buffer> input ) : input_( std::move( input ) ) {}
 
   const BufferList& input() const { return input_; }
 
@@ -125,17 +162,21 @@ public:
       return;
     }
 
-    if constexpr ( sizeof( T ) == 1 ) {
-      out = static_cast<uint8_t>( input_.peek().front() );
-      input_.remove_prefix( 1 );
+    // Fast path: the whole field is in the current buffer.
+    const std::string_view view = input_.peek();
+    if ( view.size() >= sizeof( T ) ) {
+      T raw;
+      memcpy( &raw, view.data(), sizeof( T ) );
+      out = network_order( raw );
+      input_.remove_prefix( sizeof( T ) );
       return;
-    } else {
-      out = static_cast<T>( 0 );
-      for ( size_t i = 0; i < sizeof( T ); i++ ) {
-        out <<= 8;
-        out |= static_cast<uint8_t>( input_.peek().front() );
-        input_.remove_prefix( 1 );
-      }
+    }
+
+    out = static_cast<T>( 0 );
+    for ( size_t i = 0; i < sizeof( T ); i++ ) {
+      out <<= 8;
+      out |= static_cast<uint8_t>( input_.peek().front() );
+      input_.remove_prefix( 1 );
     }
   }
 
@@ -160,28 +201,47 @@ public:
 
 class Serializer
 {
+  // Enough buffers for an Ethernet frame carrying TCP/IPv4: three headers and a payload
+  static constexpr size_t TYPICAL_BUFFERS = 4;
+
   std::vector<Buffer> output_ {};
-  std::string buffer_ {};
+  std::shared_ptr<std::string> buffer_ {}; // fields not yet flushed, in a string from BufferPool::headers()
+
+  void append( Buffer buf )
+  {
+    if ( output_.empty() ) {
+      output_.reserve( TYPICAL_BUFFERS );
+    }
+    output_.push_back( std::move( buf ) );
+  }
+
+  std::string& pending()
+  {
+    if ( not buffer_ ) {
+      buffer_ = BufferPool::headers().acquire();
+      buffer_->clear();
+    }
+    return *buffer_;
+  }
 
 public:
   Serializer() = default;
-  explicit Serializer( std::string&& buffer ) : buffer_( std::move( buffer ) ) {}
+  explicit Serializer( std::string&& buffer ) : buffer_( std::make_shared<std::string>( std::move( buffer ) ) ) {}
+
+  // Make room for `len` more bytes of fields, so that a header is built in one allocation
+  void reserve( size_t len ) { pending().reserve( pending().size() + len ); }
 
   template<std::unsigned_integral T>
   void integer( const T& val )
   {
-    constexpr uint64_t len = sizeof( T );
-
-    for ( uint64_t i = 0; i < len; ++i ) {
-      const uint8_t byte_val = val >> ( ( len - i - 1 ) * 8 );
-      buffer_.push_back( byte_val );
-    }
+    const auto bytes = std::bit_cast<std::array<char, sizeof( T )>>( network_order( val ) );
+    pending().append( bytes.data(), bytes.size() );
   }
 
   void buffer( const Buffer& buf )
   {
     flush();
-    output_.push_back( buf );
+    append( buf );
   }
 
   void buffer( const std::vector<Buffer>& bufs )
@@ -193,14 +253,20 @@ public:
 
   void flush()
   {
-    output_.emplace_back( std::move( buffer_ ) );
-    buffer_.clear();
+    if ( buffer_ and not buffer_->empty() ) {
+      append( Buffer { std::move( buffer_ ) } );
+    }
+    buffer_.reset();
   }
 
+  // The serialized buffers (at least one, possibly empty). Leaves the Serializer empty.
   std::vector<Buffer> output()
   {
     flush();
-    return output_;
+    if ( output_.empty() ) {
+      output_.emplace_back();
+    }
+    return std::move( output_ );
   }
 };
 
@@ -215,9 +281,9 @@ std::vector<Buffer> serialize( const T& obj )
 
 // Helper to parse any object (without constructing a Parser of the caller's own). Returns true if successful.
 template<class T, typename... Targs>
-bool parse( T& obj, const std::vector<Buffer>& buffers, Targs&&... Fargs )
+bool parse( T& obj, std::vector<Buffer> buffers, Targs&&... Fargs )
 {
-  Parser p { buffers };
+  Parser p { std::move( buffers ) };
   obj.parse( p, std::forward<Targs>( Fargs )... );
   return not p.has_error();
 }
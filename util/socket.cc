@@ -101,14 +101,14 @@ void Socket::shutdown( const int how )
   CheckSystemCall( "shutdown", ::shutdown( fd_num(), how ) );
   switch ( how ) {
     case SHUT_RD:
-      register_read();
+      register_read( 0 );
       break;
     case SHUT_WR:
-      register_write();
+      register_write( 0 );
       break;
     case SHUT_RDWR:
-      register_read();
-      register_write();
+      register_read( 0 );
+      register_write( 0 );
       break;
     default:
       throw runtime_error( "Socket::shutdown() called with invalid `how`" );
@@ -133,22 +133,22 @@ void DatagramSocket::recv( Address& source_address, string& payload )
     throw runtime_error( "recvfrom (oversized datagram)" );
   }
 
-  register_read();
+  register_read( recv_len );
   source_address = { datagram_source_address, fromlen };
   payload.resize( recv_len );
 }
 
 void DatagramSocket::sendto( const Address& destination, const string_view payload )
 {
-  CheckSystemCall( "sendto",
-                   ::sendto( fd_num(), payload.data(), payload.length(), 0, destination, destination.size() ) );
-  register_write();
+  const ssize_t bytes_sent = CheckSystemCall(
+    "sendto", ::sendto( fd_num(), payload.data(), payload.length(), 0, destination, destination.size() ) );
+  register_write( bytes_sent );
 }
 
 void DatagramSocket::send( const string_view payload )
 {
-  CheckSystemCall( "send", ::send( fd_num(), payload.data(), payload.length(), 0 ) );
-  register_write();
+  const ssize_t bytes_sent = CheckSystemCall( "send", ::send( fd_num(), payload.data(), payload.length(), 0 ) );
+  register_write( bytes_sent );
 }
 
 // mark the socket as listening for incoming connections
@@ -163,7 +163,7 @@ void TCPSocket::listen( const int backlog )
 //! \note This function blocks until a new connection is available
 TCPSocket TCPSocket::accept()
 {
-  register_read();
+  register_read( 0 );
   return TCPSocket( FileDescriptor( CheckSystemCall( "accept", ::accept( fd_num(), nullptr, nullptr ) ) ) );
 }
 
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// A bounded, lock-free queue between exactly one producer thread and one consumer thread.
+//
+// The producer only writes tail_ and the consumer only writes head_; each side keeps a cached copy of
+// the other's index so that it touches the shared cache line only when the queue looks full (or empty).
+template<typename T>
+class SPSCQueue
+{
+  static constexpr size_t CACHE_LINE = 64;
+
+  std::vector<std::optional<T>> slots_;
+  size_t mask_;
+
+  alignas( CACHE_LINE ) std::atomic<size_t> head_ { 0 };
+  size_t cached_tail_ { 0 };
+
+  alignas( CACHE_LINE ) std::atomic<size_t> tail_ { 0 };
+  size_t cached_head_ { 0 };
+
+public:
+  // A queue holding up to `capacity` items, rounded up to a power of two
+  explicit SPSCQueue( size_t capacity )
+    : slots_( std::bit_ceil( std::max( capacity, size_t { 1 } ) ) ), mask_( slots_.size() - 1 )
+  {}
+
+  // Producer: append `item`, unless the queue is full (in which case `item` is left untouched)
+  bool push( T&& item )
+  {
+    const size_t tail = tail_.load( std::memory_order_relaxed );
+    if ( tail - cached_head_ == slots_.size() ) {
+      cached_head_ = head_.load( std::memory_order_acquire );
+      if ( tail - cached_head_ == slots_.size() ) {
+        return false;
+      }
+    }
+    slots_[tail & mask_].emplace( std::move( item ) );
+    tail_.store( tail + 1, std::memory_order_release );
+    return true;
+  }
+
+  // Consumer: remove the oldest item, if any
+  std::optional<T> pop()
+  {
+    const size_t head = head_.load( std::memory_order_relaxed );
+    if ( head == cached_tail_ ) {
+      cached_tail_ = tail_.load( std::memory_order_acquire );
+      if ( head == cached_tail_ ) {
+        return {};
+      }
+    }
+    std::optional<T> item = std::move( slots_[head & mask_] );
+    slots_[head & mask_].reset();
+    head_.store( head + 1, std::memory_order_release );
+    return item;
+  }
+
+  // Either side: whether the queue held no items at some recent point
+  bool empty() const { return head_.load( std::memory_order_acquire ) == tail_.load( std::memory_order_acquire ); }
+
+  size_t capacity() const { return slots_.size(); }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "address.hh"
+#include "reassembler.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
@@ -20,6 +21,7 @@ public:
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
   std::optional<Wrap32> fixed_isn {};
+  Reassembler::Storage reassembler_storage = Reassembler::Storage::Map; //!< How out-of-order bytes are stored
 };
 
 //! Config for classes derived from FdAdapter
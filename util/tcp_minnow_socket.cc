@@ -18,48 +18,90 @@
 
 using namespace std;
 
-static constexpr size_t TCP_TICK_MS = 10;
+static constexpr int TCP_IDLE_MS = 1000;     // longest wait with no deadline pending (to notice _abort)
+static constexpr size_t DATAGRAM_BATCH = 32; // most datagrams read per wakeup
 
-static inline uint64_t timestamp_ms()
+template<typename AdaptT>
+void TCPMinnowSocket<AdaptT>::_tick()
 {
-  static_assert( std::is_same<std::chrono::steady_clock::duration, std::chrono::nanoseconds>::value );
+  // Whole milliseconds only; the remainder counts towards the next tick.
+  const auto elapsed = chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now() - _last_tick );
+  _last_tick += elapsed;
+
+  if ( _tcp.value().active() ) {
+    _tcp.value().tick( elapsed.count() );
+    collect_segments();
+    _datagram_adapter.tick( elapsed.count() );
+  }
+}
 
-  return std::chrono::steady_clock::now().time_since_epoch().count() / 1000000;
+template<typename AdaptT>
+void TCPMinnowSocket<AdaptT>::_schedule_tick()
+{
+  optional<uint64_t> ms;
+  if ( _tcp.value().active() ) {
+    ms = _tcp.value().ms_until_deadline();
+    const auto adapter_ms = _datagram_adapter.ms_until_deadline();
+    if ( adapter_ms and ( not ms or *adapter_ms < *ms ) ) {
+      ms = adapter_ms;
+    }
+  }
+
+  if ( not ms ) {
+    if ( _tick_timer ) {
+      _tick_timer->cancel();
+      _tick_timer.reset();
+    }
+    return;
+  }
+
+  // A timer that is due no later still does; when it runs, the loop comes back here.
+  const auto deadline = _last_tick + chrono::milliseconds( *ms );
+  if ( _tick_timer and _tick_deadline <= deadline ) {
+    return;
+  }
+  if ( _tick_timer ) {
+    _tick_timer->cancel();
+  }
+  _tick_deadline = deadline;
+  _tick_timer = _eventloop.add_timer( _tick_category, deadline, [this] {
+    _tick_timer.reset();
+    _tick();
+  } );
 }
 
 //! \param[in] condition is a function returning true if loop should continue
 template<typename AdaptT>
 void TCPMinnowSocket<AdaptT>::_tcp_loop( const function<bool()>& condition )
 {
-  auto base_time = timestamp_ms();
+  if ( not _tcp.has_value() ) {
+    throw runtime_error( "_tcp_loop entered before TCPPeer initialized" );
+  }
+
+  // Sleep until the next event or deadline, rather than waking up on a fixed tick
+  _last_tick = chrono::steady_clock::now();
   while ( condition() ) {
-    auto ret = _eventloop.wait_next_event( TCP_TICK_MS );
+    _schedule_tick();
+    auto ret = _eventloop.wait_next_event( TCP_IDLE_MS );
     if ( ret == EventLoop::Result::Exit or _abort ) {
       break;
     }
 
-    if ( not _tcp.has_value() ) {
-      throw runtime_error( "_tcp_loop entered before TCPPeer initialized" );
-    }
-
-    if ( _tcp.value().active() ) {
-      const auto next_time = timestamp_ms();
-      _tcp.value().tick( next_time - base_time );
-      collect_segments();
-      _datagram_adapter.tick( next_time - base_time );
-      base_time = next_time;
-    }
+    _tick();
   }
 }
 
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
+//! \param[in] backend is how the TCPPeer thread's EventLoop waits for its fds
 template<typename AdaptT>
 TCPMinnowSocket<AdaptT>::TCPMinnowSocket( pair<FileDescriptor, FileDescriptor> data_socket_pair,
-                                          AdaptT&& datagram_interface )
+                                          AdaptT&& datagram_interface,
+                                          const EventLoop::Backend backend )
   : LocalStreamSocket( move( data_socket_pair.first ) )
   , _thread_data( move( data_socket_pair.second ) )
   , _datagram_adapter( move( datagram_interface ) )
+  , _eventloop( backend )
 {
   _thread_data.set_blocking( false );
   set_blocking( false );
@@ -69,6 +111,7 @@ template<typename AdaptT>
 void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
 {
   _tcp.emplace( config );
+  _tick_category = _eventloop.add_category( "tick" );
 
   // Set up the event loop
 
@@ -88,14 +131,18 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
   // 4) Outbound segment generated by TCP (needs to be
   //    given to underlying datagram socket)
 
-  // rule 1: read from filtered packet stream and dump into TCPConnection
+  // rule 1: read from filtered packet stream and dump into TCPConnection (up to four batches per wakeup)
   _eventloop.add_rule(
-    "receive TCP segment from the network",
+    _eventloop.add_category( "receive TCP segment from the network", { .iterations = 4 } ),
     _datagram_adapter.fd(),
     Direction::In,
     [&] {
-      if ( auto seg = _datagram_adapter.read() ) {
-        _tcp->receive( move( seg.value() ) );
+      _datagram_adapter.read_batch( incoming_segments_, DATAGRAM_BATCH );
+      for ( auto& seg : incoming_segments_ ) {
+        _tcp->receive( move( seg ) );
+      }
+      if ( not incoming_segments_.empty() ) {
+        incoming_segments_.clear();
         collect_segments();
       }
 
@@ -108,9 +155,9 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     },
     [&] { return _tcp->active(); } );
 
-  // rule 2: read from pipe into outbound buffer
+  // rule 2: read from pipe into outbound buffer (while there is room, up to four reads per wakeup)
   _eventloop.add_rule(
-    "push bytes to TCPPeer",
+    _eventloop.add_category( "push bytes to TCPPeer", { .iterations = 4 } ),
     _thread_data,
     Direction::In,
     [&] {
@@ -152,8 +199,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
       // the pipe, handling the possibility of a partial
       // write (i.e., only pop what was actually written).
       if ( inbound.bytes_buffered() ) {
-        const std::string_view buffer = inbound.peek();
-        const auto bytes_written = _thread_data.write( buffer );
+        const auto bytes_written = _thread_data.write( inbound.peek_views() );
         inbound.pop( bytes_written );
       }
 
@@ -178,12 +224,13 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _datagram_adapter.fd(),
     Direction::Out,
     [&] {
-      while ( not outgoing_segments_.empty() ) {
-        _datagram_adapter.write( outgoing_segments_.front() );
-        outgoing_segments_.pop();
-      }
+      // Keep any the device would not take for the next time it is writable (the adapter may also be keeping
+      // frames of its own, which it sends first)
+      const size_t written = _datagram_adapter.write_batch( outgoing_segments_ );
+      outgoing_segments_.erase( outgoing_segments_.begin(),
+                                outgoing_segments_.begin() + static_cast<ptrdiff_t>( written ) );
     },
-    [&] { return not outgoing_segments_.empty(); } );
+    [&] { return not outgoing_segments_.empty() or _datagram_adapter.has_unsent(); } );
 }
 
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
@@ -197,9 +244,10 @@ static inline pair<FileDescriptor, FileDescriptor> socket_pair_helper( const int
 }
 
 //! \param[in] datagram_interface is the underlying interface (e.g. to UDP, IP, or Ethernet)
+//! \param[in] backend is how the TCPPeer thread's EventLoop waits for its fds
 template<typename AdaptT>
-TCPMinnowSocket<AdaptT>::TCPMinnowSocket( AdaptT&& datagram_interface )
-  : TCPMinnowSocket( socket_pair_helper( SOCK_STREAM ), move( datagram_interface ) )
+TCPMinnowSocket<AdaptT>::TCPMinnowSocket( AdaptT&& datagram_interface, const EventLoop::Backend backend )
+  : TCPMinnowSocket( socket_pair_helper( SOCK_STREAM ), move( datagram_interface ), backend )
 {}
 
 template<typename AdaptT>
@@ -313,7 +361,7 @@ void TCPMinnowSocket<AdaptT>::collect_segments()
   }
 
   while ( auto seg = _tcp->maybe_send() ) {
-    outgoing_segments_.push( move( seg.value() ) );
+    outgoing_segments_.push_back( move( seg.value() ) );
   }
 }
 
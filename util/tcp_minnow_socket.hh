@@ -10,6 +10,7 @@
 #include "tuntap_adapter.hh"
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <optional>
 #include <thread>
@@ -34,11 +35,26 @@ private:
   //! TCP state machine
   std::optional<TCPPeer> _tcp {};
 
+  //! Segments read from the network, waiting to be given to the TCPPeer
+  std::vector<TCPSegment> incoming_segments_ {};
+
   //! Segments queued to be sent on the network
-  std::queue<TCPSegment> outgoing_segments_ {};
+  std::vector<TCPSegment> outgoing_segments_ {};
+
+  //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes, and the
+  //! next deadline)
+  EventLoop _eventloop;
+
+  size_t _tick_category {};                                //!< EventLoop category of the tick timers
+  std::optional<EventLoop::RuleHandle> _tick_timer {};     //!< The pending tick timer, if any
+  std::chrono::steady_clock::time_point _tick_deadline {}; //!< When the pending tick timer is due
+  std::chrono::steady_clock::time_point _last_tick {};     //!< Time up to which the TCPPeer has been ticked
+
+  //! Tell the TCPPeer and the adapter how many whole milliseconds have passed since the last tick
+  void _tick();
 
-  //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
-  EventLoop _eventloop {};
+  //! Make sure a tick timer is pending for the earlier of the TCPPeer's and the adapter's next deadlines
+  void _schedule_tick();
 
   //! Process events while specified condition is true
   void _tcp_loop( const std::function<bool()>& condition );
@@ -50,7 +66,9 @@ private:
   std::thread _tcp_thread {};
 
   //! Construct LocalStreamSocket fds from socket pair, initialize eventloop
-  TCPMinnowSocket( std::pair<FileDescriptor, FileDescriptor> data_socket_pair, AdaptT&& datagram_interface );
+  TCPMinnowSocket( std::pair<FileDescriptor, FileDescriptor> data_socket_pair,
+                   AdaptT&& datagram_interface,
+                   EventLoop::Backend backend );
 
   std::atomic_bool _abort { false }; //!< Flag used by the owner to force the TCPPeer thread to shut down
 
@@ -64,7 +82,9 @@ private:
 
 public:
   //! Construct from the interface that the TCPPeer thread will use to read and write datagrams
-  explicit TCPMinnowSocket( AdaptT&& datagram_interface );
+  //! \details The TCPPeer thread's EventLoop uses poll unless another backend is asked for (see
+  //! EventLoop::Backend; io_uring is opt-in, and falls back to poll where it is unavailable).
+  explicit TCPMinnowSocket( AdaptT&& datagram_interface, EventLoop::Backend backend = EventLoop::Backend::Poll );
 
   //! Close socket, and wait for TCPPeer to finish
   //! \note Calling this function is only advisable if the socket has reached EOF,
@@ -1,5 +1,6 @@
 #include "tcp_over_ip.hh"
 
+#include "header_view.hh"
 #include "ipv4_datagram.hh"
 #include "ipv4_header.hh"
 #include "parser.hh"
@@ -41,6 +42,15 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
     return {};
   }
 
+  // can the TCP segment be for us? (checked in place, before the checksum is verified)
+  if ( not ip_dgram.payload.empty() ) {
+    if ( const auto tcp_header = TCPHeaderView::parse( ip_dgram.payload.front() ) ) {
+      if ( not related( *tcp_header ) ) {
+        return {};
+      }
+    }
+  }
+
   // is the payload a valid TCP segment?
   TCPSegment tcp_seg;
   if ( not parse( tcp_seg, ip_dgram.payload, ip_dgram.header.pseudo_checksum() ) ) {
@@ -72,24 +82,76 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
   return tcp_seg;
 }
 
-//! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
-//! \param[in] seg is the TCP segment to convert
-InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( TCPSegment& seg )
+//! \details Rejects datagrams for other connections using IPv4HeaderView, without parsing the header or
+//! copying anything. Falls back to a full parse when the IPv4 header is not contiguous in the first buffer.
+optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const vector<Buffer>& datagram )
 {
-  // set the port numbers in the TCP segment
-  seg.udinfo.src_port = config().source.port();
-  seg.udinfo.dst_port = config().destination.port();
+  const auto ip_header = datagram.empty() ? nullopt : IPv4HeaderView::parse( datagram.front() );
+  if ( not ip_header.has_value() ) {
+    InternetDatagram ip_dgram;
+    if ( not parse( ip_dgram, datagram ) ) {
+      return {};
+    }
+    return unwrap_tcp_in_ip( ip_dgram );
+  }
+
+  if ( not listening()
+       and ( ip_header->dst() != config().source.ipv4_numeric()
+             or ip_header->src() != config().destination.ipv4_numeric() ) ) {
+    return {};
+  }
+  if ( ip_header->proto() != IPv4Header::PROTO_TCP ) {
+    return {};
+  }
 
-  // create an Internet Datagram and set its addresses and length
   InternetDatagram ip_dgram;
-  ip_dgram.header.src = config().source.ipv4_numeric();
-  ip_dgram.header.dst = config().destination.ipv4_numeric();
-  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + seg.sender_message.payload.size();
+  ip_dgram.header = ip_header->header();
+  if ( datagram.front().size() > ip_header->header_length() ) {
+    ip_dgram.payload.push_back( datagram.front().substr( ip_header->header_length() ) );
+  }
+  ip_dgram.payload.insert( ip_dgram.payload.end(), datagram.begin() + 1, datagram.end() );
+  return unwrap_tcp_in_ip( ip_dgram );
+}
+
+//! \details Mirrors the port checks in unwrap_tcp_in_ip, so that they can run before the segment is parsed.
+bool TCPOverIPv4Adapter::related( const TCPHeaderView& tcp_header ) const
+{
+  if ( tcp_header.dst_port() != config().source.port() ) {
+    return false;
+  }
+  if ( listening() ) {
+    return tcp_header.SYN() and not tcp_header.RST();
+  }
+  return tcp_header.src_port() == config().destination.port();
+}
+
+//! \details The template is rebuilt only when the configuration (addresses and ports) may have changed,
+//! e.g. when a listening adapter accepts a connection.
+const TCPIPv4HeaderTemplate& TCPOverIPv4Adapter::header_template( TCPSegment& seg )
+{
+  if ( not _header_template.has_value() or _header_template_generation != config_generation() ) {
+    _header_template.emplace( config().source.ipv4_numeric(),
+                              config().source.port(),
+                              config().destination.ipv4_numeric(),
+                              config().destination.port() );
+    _header_template_generation = config_generation();
+  }
+
+  // set the port numbers in the TCP segment
+  seg.udinfo.src_port = _header_template->src_port();
+  seg.udinfo.dst_port = _header_template->dst_port();
+  return *_header_template;
+}
 
-  // set payload, calculating TCP checksum using information from IP header
-  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
-  ip_dgram.header.compute_checksum();
-  ip_dgram.payload = serialize( seg );
+//! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
+//! \param[in] seg is the TCP segment to convert
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( TCPSegment& seg )
+{
+  return header_template( seg ).wrap( seg );
+}
 
-  return ip_dgram;
+//! \param[in] seg is the TCP segment to convert
+std::vector<Buffer> TCPOverIPv4Adapter::serialize_tcp_in_ip( TCPSegment& seg )
+{
+  return header_template( seg ).serialize( seg );
 }
@@ -2,6 +2,8 @@
 
 #include "buffer.hh"
 #include "fd_adapter.hh"
+#include "header_template.hh"
+#include "header_view.hh"
 #include "ipv4_datagram.hh"
 #include "tcp_segment.hh"
 
@@ -10,8 +12,24 @@
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase
 {
+private:
+  std::optional<TCPIPv4HeaderTemplate> _header_template {}; //!< Headers for the configured flow
+  uint64_t _header_template_generation {};                  //!< config_generation() it was built for
+
+  //! Set the segment's ports and return the header template for the current configuration
+  const TCPIPv4HeaderTemplate& header_template( TCPSegment& seg );
+
+  //! Could a segment with this header belong to the connection?
+  bool related( const TCPHeaderView& tcp_header ) const;
+
 public:
   std::optional<TCPSegment> unwrap_tcp_in_ip( const InternetDatagram& ip_dgram );
 
+  //! Like unwrap_tcp_in_ip, but takes the serialized datagram
+  std::optional<TCPSegment> unwrap_tcp_in_ip( const std::vector<Buffer>& datagram );
+
   InternetDatagram wrap_tcp_in_ip( TCPSegment& seg );
+
+  //! Like wrap_tcp_in_ip, but returns the serialized datagram
+  std::vector<Buffer> serialize_tcp_in_ip( TCPSegment& seg );
 };
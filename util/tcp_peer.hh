@@ -14,7 +14,7 @@ class TCPPeer
   TCPConfig cfg_;
   TCPSender sender_ { cfg_.rt_timeout, cfg_.fixed_isn };
   TCPReceiver receiver_ {};
-  Reassembler reassembler_ {};
+  Reassembler reassembler_ { cfg_.reassembler_storage };
 
   ByteStream outbound_stream_ { cfg_.send_capacity }, inbound_stream_ { cfg_.recv_capacity };
 
@@ -28,6 +28,7 @@ public:
 
   void push() { sender_.push( outbound_stream_.reader() ); };
   void tick( uint64_t ms_since_last_tick ) { sender_.tick( ms_since_last_tick ); }
+  std::optional<uint64_t> ms_until_deadline() const { return sender_.ms_until_deadline(); }
 
   bool has_ackno() const { return receiver_.send( inbound_stream_.writer() ).ackno.has_value(); }
 
@@ -11,12 +11,9 @@ using namespace std;
 void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
 {
   {
-    /* verify checksum */
-    Parser parser2 = parser;
-    Buffer all_remaining;
-    parser2.all_remaining( all_remaining );
+    /* verify checksum, over the input in place */
     InternetChecksum check { datagram_layer_pseudo_checksum };
-    check.add( all_remaining );
+    parser.input().for_each( [&]( const string_view piece ) { check.add( piece ); } );
     if ( check.value() ) {
       parser.set_error();
       return;
@@ -61,22 +58,22 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   parser.all_remaining( sender_message.payload );
 }
 
-class Wrap32Serializable : public Wrap32
+uint8_t TCPSegment::flags() const
 {
-public:
-  uint32_t raw_value() const { return raw_value_; }
-};
+  return ( receiver_message.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
+         | ( sender_message.SYN ? 0b0000'0010U : 0 ) | ( sender_message.FIN ? 0b0000'0001U : 0 );
+}
 
 void TCPSegment::serialize( Serializer& serializer ) const
 {
+  serializer.reserve( TCPHeaderMinLen * 4 );
+
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { sender_message.seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { receiver_message.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
   serializer.integer( uint8_t { TCPHeaderMinLen << 4 } ); // data offset
-  const uint8_t flags = ( receiver_message.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
-                        | ( sender_message.SYN ? 0b0000'0010U : 0 ) | ( sender_message.FIN ? 0b0000'0001U : 0 );
-  serializer.integer( flags );
+  serializer.integer( flags() );
   serializer.integer( receiver_message.window_size );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
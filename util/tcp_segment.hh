@@ -5,8 +5,17 @@
 #include "tcp_sender_message.hh"
 #include "udinfo.hh"
 
+// Wrap32 with access to the raw value, for serialization
+class Wrap32Serializable : public Wrap32
+{
+public:
+  uint32_t raw_value() const { return raw_value_; }
+};
+
 struct TCPSegment
 {
+  static constexpr size_t HEADER_LENGTH = 20; // TCP header length, not including options
+
   TCPSenderMessage sender_message {};
   TCPReceiverMessage receiver_message {};
   bool reset {}; // Connection experienced an abnormal error and should be shut down
@@ -16,4 +25,7 @@ struct TCPSegment
   void serialize( Serializer& serializer ) const;
 
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
+
+  // The flags byte of the TCP header (ACK, RST, SYN and FIN)
+  uint8_t flags() const;
 };
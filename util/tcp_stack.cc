@@ -0,0 +1,274 @@
+#include "tcp_stack.hh"
+
+#include "header_view.hh"
+#include "ipv4_header.hh"
+#include "parser.hh"
+
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+static constexpr size_t DATAGRAM_BATCH = 64; // most datagrams read per wakeup
+
+TCPStack::Connection::Connection( const FourTuple& tuple, const TCPConfig& config, const uint64_t now )
+  : _tuple( tuple )
+  , _peer( config )
+  , _headers( tuple.local_address, tuple.local_port, tuple.remote_address, tuple.remote_port )
+  , _last_tick( now )
+{}
+
+TCPStack::TCPStack( FileDescriptor&& device, EventLoop& eventloop )
+  : _device( move( device ) ), _eventloop( eventloop ), _timer_category( _eventloop.add_category( "TCP timers" ) )
+{
+  _device.set_blocking( false );
+
+  _rules.push_back( _eventloop.add_rule( _eventloop.add_category( "receive TCP datagrams", { .iterations = 4 } ),
+                                         _device,
+                                         Direction::In,
+                                         [this] { receive_datagrams(); } ) );
+
+  _rules.push_back( _eventloop.add_rule(
+    "send TCP datagrams",
+    _device,
+    Direction::Out,
+    [this] {
+      // Keep any the device would not take for the next time it is writable
+      const size_t written = _device.write( span<const vector<Buffer>> { _outgoing } );
+      _outgoing.erase( _outgoing.begin(), _outgoing.begin() + static_cast<ptrdiff_t>( written ) );
+    },
+    [this] { return not _outgoing.empty(); } ) );
+}
+
+TCPStack::~TCPStack()
+{
+  for ( auto& rule : _rules ) {
+    rule.cancel();
+  }
+  if ( _timer ) {
+    _timer->cancel();
+  }
+}
+
+uint64_t TCPStack::now() const
+{
+  return chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now() - _start ).count();
+}
+
+void TCPStack::listen( const TCPConfig& config, const Address& local, ConnectionCallback on_accept )
+{
+  if ( not _listeners.try_emplace( local.port(), config, local.ipv4_numeric(), move( on_accept ) ).second ) {
+    throw runtime_error( "TCPStack: already listening on port " + to_string( local.port() ) );
+  }
+}
+
+shared_ptr<TCPStack::Connection> TCPStack::connect( const TCPConfig& config,
+                                                    const Address& local,
+                                                    const Address& remote )
+{
+  const FourTuple tuple { local.ipv4_numeric(), remote.ipv4_numeric(), local.port(), remote.port() };
+  auto connection = make_shared<Connection>( tuple, config, now() );
+  if ( not _connections.insert( tuple, connection ) ) {
+    throw runtime_error( "TCPStack: a connection from " + local.to_string() + " to " + remote.to_string()
+                         + " already exists" );
+  }
+
+  connection->_peer.push();
+  send( connection );
+  update_timer();
+  return connection;
+}
+
+void TCPStack::push( const shared_ptr<Connection>& connection )
+{
+  if ( connection->_closed ) {
+    return;
+  }
+  advance( *connection, now() );
+  connection->_peer.push();
+  send( connection );
+  update_timer();
+}
+
+void TCPStack::receive_datagrams()
+{
+  _packets.resize( DATAGRAM_BATCH );
+  const size_t count = _device.read( span { _packets } );
+  const uint64_t time = now();
+  for ( size_t i = 0; i < count; ++i ) {
+    receive( _packets[i], time );
+  }
+
+  // Serve each connection once per batch, so that its replies (e.g. ACKs) cover all of its segments
+  for ( const auto& connection : _pending ) {
+    connection->_pending = false;
+    serve( connection );
+  }
+  _pending.clear();
+  update_timer();
+}
+
+//! \details The 4-tuple is read in place with IPv4HeaderView and TCPHeaderView, so a datagram for no connection
+//! is dropped without being parsed or checksummed.
+void TCPStack::receive( const Buffer& datagram, const uint64_t now )
+{
+  const auto ip_header = IPv4HeaderView::parse( datagram );
+  if ( not ip_header or ip_header->proto() != IPv4Header::PROTO_TCP ) {
+    ++_dropped;
+    return;
+  }
+  const Buffer payload = datagram.substr( ip_header->header_length() );
+  const auto tcp_header = TCPHeaderView::parse( payload );
+  if ( not tcp_header ) {
+    ++_dropped;
+    return;
+  }
+
+  const FourTuple tuple { ip_header->dst(), ip_header->src(), tcp_header->dst_port(), tcp_header->src_port() };
+  shared_ptr<Connection> connection;
+  const Listener* listener = nullptr;
+  if ( const auto* found = _connections.find( tuple ) ) {
+    connection = *found;
+  } else if ( tcp_header->SYN() and not tcp_header->RST() ) {
+    const auto it = _listeners.find( tuple.local_port );
+    if ( it != _listeners.end() and ( it->second.address == 0 or it->second.address == tuple.local_address ) ) {
+      listener = &it->second;
+    }
+  }
+  if ( not connection and not listener ) {
+    ++_dropped;
+    return;
+  }
+
+  TCPSegment seg;
+  if ( not parse( seg, { payload }, ip_header->header().pseudo_checksum() ) ) {
+    ++_dropped;
+    return;
+  }
+
+  if ( listener ) {
+    connection = make_shared<Connection>( tuple, listener->config, now );
+    connection->_on_established = listener->on_accept;
+    _connections.insert( tuple, connection );
+  }
+
+  advance( *connection, now );
+  connection->_peer.receive( move( seg ) );
+  if ( not connection->_pending ) {
+    connection->_pending = true;
+    _pending.push_back( move( connection ) );
+  }
+}
+
+void TCPStack::advance( Connection& connection, const uint64_t now )
+{
+  if ( now > connection._last_tick ) {
+    connection._peer.tick( now - connection._last_tick );
+    connection._last_tick = now;
+  }
+}
+
+void TCPStack::serve( const shared_ptr<Connection>& connection )
+{
+  TCPPeer& peer = connection->_peer;
+  if ( not connection->_established and peer.has_ackno() and peer.sender().sequence_numbers_in_flight() == 0 ) {
+    connection->_established = true;
+    if ( connection->_on_established ) {
+      exchange( connection->_on_established, {} )( connection );
+    }
+  }
+  if ( connection->_established and connection->_on_receive ) {
+    connection->_on_receive();
+  }
+  send( connection );
+}
+
+void TCPStack::send( const shared_ptr<Connection>& connection )
+{
+  TCPPeer& peer = connection->_peer;
+  while ( auto seg = peer.maybe_send() ) {
+    _outgoing.push_back( connection->_headers.serialize( seg.value(), _ip_id++ ) );
+  }
+
+  if ( not peer.active() ) {
+    if ( not connection->_closed ) {
+      connection->_closed = true;
+      _connections.erase( connection->_tuple );
+    }
+    return;
+  }
+
+  // Schedule a timer only if it is due before the one already scheduled; when that one expires, it reschedules
+  // for the connection's deadline then. (Pushing the deadline back, as each ACK does, touches no timer.)
+  const auto ms = peer.ms_until_deadline();
+  connection->_deadline = ms ? optional { connection->_last_tick + *ms } : nullopt;
+  if ( connection->_deadline and ( not connection->_timer or *connection->_deadline < *connection->_timer ) ) {
+    connection->_timer = connection->_deadline;
+    _deadlines.schedule( connection, *connection->_timer );
+  }
+}
+
+void TCPStack::expire()
+{
+  const uint64_t time = now();
+  _deadlines.expire( time, [&]( const shared_ptr<Connection>& connection, const uint64_t deadline ) {
+    if ( connection->_closed or connection->_timer != deadline ) {
+      return; // superseded by an earlier timer
+    }
+    connection->_timer.reset();
+    if ( connection->_deadline and not connection->_pending ) {
+      connection->_pending = true;
+      _pending.push_back( connection );
+    }
+  } );
+
+  for ( const auto& connection : _pending ) {
+    connection->_pending = false;
+    if ( *connection->_deadline > time ) {
+      connection->_timer = connection->_deadline;
+      _deadlines.schedule( connection, *connection->_timer );
+      continue;
+    }
+
+    advance( *connection, time );
+    TCPPeer& peer = connection->_peer;
+    if ( peer.sender().consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS ) {
+      // Give up, as if the remote end had reset the connection
+      TCPSegment reset;
+      reset.reset = true;
+      peer.receive( move( reset ) );
+      if ( connection->_established and connection->_on_receive ) {
+        connection->_on_receive();
+      }
+    }
+    send( connection );
+  }
+  _pending.clear();
+}
+
+void TCPStack::update_timer()
+{
+  const auto next = _deadlines.next_deadline();
+  if ( not next ) {
+    if ( _timer ) {
+      _timer->cancel();
+      _timer.reset();
+    }
+    return;
+  }
+
+  // A timer that is due no later still does; when it runs, it comes back here.
+  if ( _timer and _timer_deadline <= *next ) {
+    return;
+  }
+  if ( _timer ) {
+    _timer->cancel();
+  }
+  _timer_deadline = *next;
+  _timer = _eventloop.add_timer( _timer_category, _start + chrono::milliseconds( *next ), [this] {
+    _timer.reset();
+    expire();
+    update_timer();
+  } );
+}
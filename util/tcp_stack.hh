@@ -0,0 +1,149 @@
+#pragma once
+
+#include "address.hh"
+#include "buffer.hh"
+#include "connection_table.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "header_template.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+#include "timer_queue.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Many TCP connections over one device that carries IPv4 datagrams (e.g. a TUN device), served by one
+//! EventLoop on one thread
+//! \details Each datagram read is matched to its connection by 4-tuple, with one ConnectionTable lookup, before
+//! its checksum is verified. A SYN that matches no connection opens one if its port is listening; the
+//! listener's callback gets the connection once the handshake completes. Retransmission deadlines are kept in
+//! one TimerQueue, and the stack keeps one EventLoop timer, for the earliest of them.
+//!
+//! Every connection's streams are allocated up front (see TCPConfig), so thousands of connections call for
+//! small capacities.
+class TCPStack
+{
+public:
+  class Connection;
+
+  //! Called with a connection whose handshake has completed
+  using ConnectionCallback = std::function<void( const std::shared_ptr<Connection>& )>;
+
+  //! \brief One TCP connection of a TCPStack
+  //! \details The application reads from inbound_reader() and writes to outbound_writer(); writes (and
+  //! closing the outbound stream) are sent when TCPStack::push() is called, or when a receive callback returns.
+  class Connection
+  {
+    friend class TCPStack;
+
+    FourTuple _tuple;
+    TCPPeer _peer;
+    TCPIPv4HeaderTemplate _headers;        //!< Headers for segments to the remote end
+    uint64_t _last_tick;                   //!< Stack time (ms) up to which the TCPPeer has been ticked
+    std::optional<uint64_t> _deadline {};  //!< When the TCPPeer next needs a tick, if ever
+    std::optional<uint64_t> _timer {};     //!< Deadline of the timer scheduled for the connection, if any
+    ConnectionCallback _on_established {}; //!< The listener's callback, until the handshake completes
+    std::function<void()> _on_receive {};  //!< Set by the application
+    bool _established {};                  //!< Has the handshake completed?
+    bool _pending {};                      //!< Is the connection waiting to be served after a batch of segments?
+    bool _closed {};                       //!< Has the connection left the table?
+
+  public:
+    Connection( const FourTuple& tuple, const TCPConfig& config, uint64_t now );
+
+    const FourTuple& tuple() const { return _tuple; }
+    Writer& outbound_writer() { return _peer.outbound_writer(); }
+    Reader& inbound_reader() { return _peer.inbound_reader(); }
+    const TCPPeer& peer() const { return _peer; }
+
+    bool established() const { return _established; }
+
+    //! Is the connection still in its stack's table? (It leaves once its TCPPeer is no longer active.)
+    bool open() const { return not _closed; }
+
+    //! Call `on_receive` after each batch of segments for the (established) connection has been received
+    void set_receive_callback( std::function<void()> on_receive ) { _on_receive = std::move( on_receive ); }
+  };
+
+private:
+  //! A port that accepts connections
+  struct Listener
+  {
+    TCPConfig config;
+    uint32_t address; //!< The local address it accepts connections to, or 0 for any
+    ConnectionCallback on_accept;
+  };
+
+  FileDescriptor _device;
+  EventLoop& _eventloop;
+  std::chrono::steady_clock::time_point _start { std::chrono::steady_clock::now() }; //!< Stack time zero
+
+  ConnectionTable<std::shared_ptr<Connection>> _connections {};
+  std::unordered_map<uint16_t, Listener> _listeners {}; //!< By port
+
+  TimerQueue<std::shared_ptr<Connection>> _deadlines {}; //!< Connections' timers, in stack time
+  size_t _timer_category;
+  std::optional<EventLoop::RuleHandle> _timer {}; //!< The EventLoop timer for the earliest deadline, if any
+  uint64_t _timer_deadline {};                    //!< When it is due
+  std::vector<EventLoop::RuleHandle> _rules {};   //!< The device's rules, cancelled on destruction
+
+  std::vector<Buffer> _packets {};                      //!< Datagrams read from the device
+  std::vector<std::shared_ptr<Connection>> _pending {}; //!< Connections that received segments in this batch
+  std::vector<std::vector<Buffer>> _outgoing {};        //!< Datagrams waiting for the device to be writable
+  uint16_t _ip_id {};                                   //!< IPv4 ID of the next datagram
+  uint64_t _dropped {};
+
+  //! Milliseconds since the stack started
+  uint64_t now() const;
+
+  //! Read a batch of datagrams, give each segment to its connection, and serve the connections that got any
+  void receive_datagrams();
+
+  //! Demultiplex one datagram to its connection (opening one for a SYN to a listening port)
+  void receive( const Buffer& datagram, uint64_t now );
+
+  //! Tick the connection's TCPPeer up to `now`
+  static void advance( Connection& connection, uint64_t now );
+
+  //! Tell the application about the connection's new segments, then send what its TCPPeer has to send
+  void serve( const std::shared_ptr<Connection>& connection );
+
+  //! Queue the TCPPeer's segments, and close the connection or schedule its next deadline
+  void send( const std::shared_ptr<Connection>& connection );
+
+  //! Tick the connections whose deadlines have passed
+  void expire();
+
+  //! Make sure the EventLoop timer is pending for the earliest deadline (or cancelled if there is none)
+  void update_timer();
+
+public:
+  //! Serve connections over `device`, with rules and a timer in `eventloop`
+  //! \details The device is made non-blocking, and gets one rule for reading and one for writing.
+  TCPStack( FileDescriptor&& device, EventLoop& eventloop );
+
+  //! Accept connections to `local` (address 0: any local address), passing each to `on_accept` once established
+  void listen( const TCPConfig& config, const Address& local, ConnectionCallback on_accept );
+
+  //! Open a connection from `local` to `remote` (sending its SYN); it becomes established() when the handshake
+  //! completes
+  std::shared_ptr<Connection> connect( const TCPConfig& config, const Address& local, const Address& remote );
+
+  //! Send what the application has written to the connection's outbound stream (or that it closed the stream)
+  void push( const std::shared_ptr<Connection>& connection );
+
+  size_t connection_count() const { return _connections.size(); } //!< Connections in the table
+  uint64_t dropped() const { return _dropped; } //!< Datagrams that were invalid or for no connection
+
+  TCPStack( const TCPStack& other ) = delete;
+  TCPStack& operator=( const TCPStack& other ) = delete;
+  TCPStack( TCPStack&& other ) = delete;
+  TCPStack& operator=( TCPStack&& other ) = delete;
+  ~TCPStack();
+};
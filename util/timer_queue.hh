@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <vector>
+
+// A set of one-shot timers, each a (deadline, key) pair, kept in a min-heap by deadline so that
+// expiring the due timers touches only those timers.
+//
+// Timers are not cancelled or moved in place. To cancel or push back a timer, the owner records
+// the deadline it currently wants for the key (e.g. next to the entry the timer guards), schedules
+// a new timer if needed, and ignores any expired timer whose deadline no longer matches the record.
+// Deadlines are in whatever monotonic unit the owner uses (e.g. milliseconds since construction).
+template<typename Key>
+class TimerQueue
+{
+  struct Timer
+  {
+    uint64_t deadline;
+    Key key;
+
+    bool operator>( const Timer& other ) const { return deadline > other.deadline; }
+  };
+
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_ {};
+
+public:
+  // Arrange for `key` to expire at `deadline`
+  void schedule( const Key& key, uint64_t deadline ) { timers_.push( { deadline, key } ); }
+
+  // Remove every timer due at or before `now`, calling on_expire( key, deadline ) for each in deadline order
+  template<typename Callback>
+  void expire( uint64_t now, Callback&& on_expire )
+  {
+    while ( not timers_.empty() and timers_.top().deadline <= now ) {
+      const Timer timer = timers_.top();
+      timers_.pop();
+      on_expire( timer.key, timer.deadline );
+    }
+  }
+
+  // Remove the earliest timers for as long as drop( key ) is true, e.g. to discard timers no longer wanted
+  template<typename Predicate>
+  void drop_while( Predicate&& drop )
+  {
+    while ( not timers_.empty() and drop( timers_.top().key ) ) {
+      timers_.pop();
+    }
+  }
+
+  // The earliest pending deadline, if any
+  std::optional<uint64_t> next_deadline() const
+  {
+    if ( timers_.empty() ) {
+      return {};
+    }
+    return timers_.top().deadline;
+  }
+
+  bool empty() const { return timers_.empty(); }
+  size_t size() const { return timers_.size(); }
+};
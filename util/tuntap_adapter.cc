@@ -3,18 +3,37 @@
 
 using namespace std;
 
+TCPOverIPv4OverTunFdAdapter::TCPOverIPv4OverTunFdAdapter( TunFD&& tun ) : _tun( move( tun ) )
+{
+  _tun.set_blocking( false );
+}
+
 optional<TCPSegment> TCPOverIPv4OverTunFdAdapter::read()
 {
-  vector<string> strs( 2 );
-  strs.front().resize( IPv4Header::LENGTH );
-  _tun.read( strs );
-
-  InternetDatagram ip_dgram;
-  const vector<Buffer> buffers = { strs.at( 0 ), strs.at( 1 ) };
-  if ( parse( ip_dgram, buffers ) ) {
-    return unwrap_tcp_in_ip( ip_dgram );
+  Buffer packet;
+  _tun.read( packet );
+  return unwrap_tcp_in_ip( vector<Buffer> { move( packet ) } );
+}
+
+void TCPOverIPv4OverTunFdAdapter::read_batch( vector<TCPSegment>& segments, const size_t max_datagrams )
+{
+  _packets.resize( max_datagrams );
+  const size_t count = _tun.read( span { _packets } );
+  for ( size_t i = 0; i < count; ++i ) {
+    if ( auto seg = unwrap_tcp_in_ip( vector<Buffer> { move( _packets[i] ) } ) ) {
+      segments.push_back( move( seg.value() ) );
+    }
   }
-  return {};
+}
+
+size_t TCPOverIPv4OverTunFdAdapter::write_batch( span<TCPSegment> segments )
+{
+  vector<vector<Buffer>> datagrams;
+  datagrams.reserve( segments.size() );
+  for ( auto& seg : segments ) {
+    datagrams.push_back( serialize_tcp_in_ip( seg ) );
+  }
+  return _tun.write( span<const vector<Buffer>> { datagrams } );
 }
 
 //! \param[in] tap Raw network device that will be owned by the adapter
@@ -31,29 +50,45 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(
   // Linux seems to ignore the first frame sent on a TAP device, so send a dummy frame to prime the pump :-(
   const EthernetFrame dummy_frame;
   _tap.write( serialize( dummy_frame ) );
+
+  _tap.set_blocking( false );
 }
 
 optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read()
 {
   // Read Ethernet frame from the raw device
-  vector<string> strs( 3 );
-  strs.at( 0 ).resize( EthernetHeader::LENGTH );
-  strs.at( 1 ).resize( IPv4Header::LENGTH );
-  _tap.read( strs );
+  Buffer packet;
+  _tap.read( packet );
+  auto seg = receive_frame( move( packet ) );
+
+  // The incoming frame may have caused the NetworkInterface to send a frame.
+  send_pending();
+
+  return seg;
+}
+
+void TCPOverIPv4OverEthernetAdapter::read_batch( vector<TCPSegment>& segments, const size_t max_datagrams )
+{
+  _frames.resize( max_datagrams );
+  const size_t count = _tap.read( span { _frames } );
+  for ( size_t i = 0; i < count; ++i ) {
+    if ( auto seg = receive_frame( move( _frames[i] ) ) ) {
+      segments.push_back( move( seg.value() ) );
+    }
+  }
+  send_pending();
+}
 
+optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::receive_frame( Buffer frame_buffer )
+{
   EthernetFrame frame;
-  vector<Buffer> buffers;
-  ranges::transform( strs, back_inserter( buffers ), identity() );
-  if ( not parse( frame, buffers ) ) {
+  if ( not parse( frame, { move( frame_buffer ) } ) ) {
     return {};
   }
 
   // Give the frame to the NetworkInterface. Get back an Internet datagram if frame was carrying one.
   optional<InternetDatagram> ip_dgram = _interface.recv_frame( frame );
 
-  // The incoming frame may have caused the NetworkInterface to send a frame.
-  send_pending();
-
   // Try to interpret IPv4 datagram as TCP
   if ( ip_dgram ) {
     return unwrap_tcp_in_ip( ip_dgram.value() );
@@ -75,10 +110,25 @@ void TCPOverIPv4OverEthernetAdapter::write( TCPSegment& seg )
   send_pending();
 }
 
+//! \param[in] segments the TCPSegments to send
+size_t TCPOverIPv4OverEthernetAdapter::write_batch( span<TCPSegment> segments )
+{
+  for ( auto& seg : segments ) {
+    _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
+  }
+  send_pending();
+  return segments.size();
+}
+
 void TCPOverIPv4OverEthernetAdapter::send_pending()
 {
   while ( auto frame = _interface.maybe_send() ) {
-    _tap.write( serialize( frame.value() ) );
+    _unsent.push_back( serialize( frame.value() ) );
+  }
+  if ( not _unsent.empty() ) {
+    // Keep any the device would not take for the next time it is writable
+    const size_t written = _tap.write( span<const vector<Buffer>> { _unsent } );
+    _unsent.erase( _unsent.begin(), _unsent.begin() + static_cast<ptrdiff_t>( written ) );
   }
 }
 
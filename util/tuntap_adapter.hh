@@ -7,6 +7,7 @@
 #include "tun.hh"
 
 #include <optional>
+#include <span>
 #include <unordered_map>
 #include <utility>
 
@@ -16,15 +17,27 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter
 private:
   TunFD _tun;
 
+  std::vector<Buffer> _packets {}; //!< Datagrams read by read_batch()
+
 public:
   //! Construct from a TunFD
-  explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun ) : _tun( std::move( tun ) ) {}
+  //! \details The TUN device is made non-blocking, so that read_batch() can drain the datagrams that are ready.
+  //! (Writes to a TUN device never block; the kernel drops what it cannot queue.)
+  explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun );
 
   //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
   std::optional<TCPSegment> read();
 
+  //! Reads up to `max_datagrams` datagrams that are ready, and appends the TCP segments related to the current
+  //! connection to `segments`
+  void read_batch( std::vector<TCPSegment>& segments, size_t max_datagrams );
+
   //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-  void write( TCPSegment& seg ) { _tun.write( serialize( wrap_tcp_in_ip( seg ) ) ); }
+  void write( TCPSegment& seg ) { _tun.write( serialize_tcp_in_ip( seg ) ); }
+
+  //! Writes the segments in order, each in its own datagram, until the TUN device would block
+  //! \returns the number of segments written
+  size_t write_batch( std::span<TCPSegment> segments );
 
   //! Access the underlying TUN device
   explicit operator TunFD&() { return _tun; }
@@ -49,10 +62,16 @@ private:
 
   Address _next_hop; //!< IP address of the next hop
 
-  void send_pending(); //!< Sends any pending Ethernet frames
+  std::vector<Buffer> _frames {};              //!< Frames read by read_batch()
+  std::vector<std::vector<Buffer>> _unsent {}; //!< Frames the TAP device would not take yet, oldest first
+
+  void send_pending(); //!< Sends any pending Ethernet frames, keeping those the TAP device would not take
+
+  //! Gives a frame to the NetworkInterface, and returns the TCP segment it carried, if any
+  std::optional<TCPSegment> receive_frame( Buffer frame );
 
 public:
-  //! Construct from a TapFD
+  //! Construct from a TapFD, which is made non-blocking (as for TCPOverIPv4OverTunFdAdapter)
   explicit TCPOverIPv4OverEthernetAdapter( TapFD&& tap,
                                            const EthernetAddress& eth_address,
                                            const Address& ip_address,
@@ -60,12 +79,26 @@ public:
   //! Attempts to read and parse an Ethernet frame containing an IPv4 datagram that contains a TCP segment
   std::optional<TCPSegment> read();
 
+  //! Reads up to `max_datagrams` frames that are ready, and appends the TCP segments they carried to `segments`
+  void read_batch( std::vector<TCPSegment>& segments, size_t max_datagrams );
+
   //! Sends a TCP segment (in an IPv4 datagram, in an Ethernet frame).
   void write( TCPSegment& seg );
 
+  //! Sends each TCP segment, as write() does, after any frames kept from earlier calls
+  //! \returns the number of segments sent (all of them: the frames the TAP device would not take are kept, and
+  //! sent by the next call)
+  size_t write_batch( std::span<TCPSegment> segments );
+
+  //! Are frames waiting for the TAP device to be writable?
+  bool has_unsent() const { return not _unsent.empty(); }
+
   //! Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
 
+  //! Milliseconds until the NetworkInterface's next timer expires, if any
+  std::optional<uint64_t> ms_until_deadline() const { return _interface.ms_until_deadline(); }
+
   //! Access the underlying raw Ethernet connection
   explicit operator TapFD&() { return _tap; }
 